@@ -27,6 +27,12 @@ pointfile = "./xy"
 datafile = "./%06i.v"
 nfile = "./n"
 
+# reads shakemovie packets OUTPUT_FILES/bin_movie*.gz directly in the renderer,
+# without extracting data frames by genDataFromBin first
+direct_read = True
+packet_pointfile = "OUTPUT_FILES/bin_movie.xy.gz"
+packet_datafile = "OUTPUT_FILES/bin_movie_%06i.d.gz"
+
 
 def extract_wavefield(nframes,timestep,every,nframes_start):
     """
@@ -95,6 +101,7 @@ def renderEvent(tag="earth",timestep=100,endtimestep=100,interlace=0,nowaves=Fal
     """
     global root,bin_genData,bin_render
     global pointfile,datafile,nfile
+    global direct_read,packet_pointfile,packet_datafile
 
     ########################################################################
     ##
@@ -341,9 +348,24 @@ def renderEvent(tag="earth",timestep=100,endtimestep=100,interlace=0,nowaves=Fal
     print("            end frame: ",nframes_end)
     print("")
 
+    # packet file numbers: (frame + offset) * step
+    if nframes == 1:
+        packet_offset = 1
+        packet_step = timestep
+    else:
+        packet_offset = nframes_start + 1
+        packet_step = every
+
     # calls binary to extract wavefield data (from .gz files)
     if not nowaves:
-        extract_wavefield(nframes,timestep,every,nframes_start)
+        if direct_read:
+            if not os.path.isfile(packet_pointfile):
+                print("Packet file ",packet_pointfile," not found. Please check")
+                sys.exit(1)
+            print("reading packets directly: ",packet_datafile)
+            print("")
+        else:
+            extract_wavefield(nframes,timestep,every,nframes_start)
 
 
     ##############################################################################
@@ -514,7 +536,7 @@ def renderEvent(tag="earth",timestep=100,endtimestep=100,interlace=0,nowaves=Fal
     print("")
 
     # Figure out how many points and frames there are
-    if not nowaves:
+    if not nowaves and not direct_read:
         # from perl:
         #   $io = new IO::File("<$nfile");
         #   $buf = '';
@@ -1293,10 +1315,17 @@ def renderEvent(tag="earth",timestep=100,endtimestep=100,interlace=0,nowaves=Fal
     #       + [" -masknoise 2500 0 45"]
 
     # data import
-    cmd_options += [" -datafiletemplate {}".format(datafile)] \
-           + [" -coordsfile {}".format(pointfile)] \
-           + [" {}".format(framesteps)] \
-           + [" -ncoords {}".format(npoints)]
+    if direct_read:
+        # number of points determined from packet
+        cmd_options += [" -datafiletemplate {}".format(packet_datafile)] \
+               + [" -datafileindex {} {}".format(packet_offset,packet_step)] \
+               + [" -coordsfile {}".format(packet_pointfile)] \
+               + [" {}".format(framesteps)]
+    else:
+        cmd_options += [" -datafiletemplate {}".format(datafile)] \
+               + [" -coordsfile {}".format(pointfile)] \
+               + [" {}".format(framesteps)] \
+               + [" -ncoords {}".format(npoints)]
 
     # additionals
     cmd_options += addons
@@ -0,0 +1,122 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// baseLayer.h
+#ifndef BASELAYER_H
+#define BASELAYER_H
+
+/* -----------------------------------------------------------------------------------------------
+
+base layer
+
+ rendered globe below the wavefield, for views where neither globe nor sun rotate: surface map,
+ lines, diffuse and specular light and night map give the same pixels in every frame. the first
+ frame records the colors of each pixel on the sphere together with the pixel state the layers
+ above need (water, light factor, map position) and the static part of the cloud layer (cloud
+ intensity and shading). the frames after start from these and only blend wavefield, clouds and
+ contours on top.
+
+ arrays are indexed like the pixel geometry cache (see PixelGeometry::index).
+
+----------------------------------------------------------------------------------------------- */
+
+#define BASELAYER_OFF    0
+#define BASELAYER_RECORD 1
+#define BASELAYER_REPLAY 2
+
+class BaseLayer {
+public:
+  BaseLayer();
+  ~BaseLayer();
+
+  bool init(int npixels);
+  void release();
+
+  int mode;
+
+  // below wavefield
+  unsigned char *rgb;
+  unsigned char *water;
+  double *lightfactor;
+  int    *tx;
+  int    *ty;
+
+  // cloud layer
+  float *cloud;
+  float *cloudshade;
+
+private:
+  // not copyable (owns its arrays)
+  BaseLayer(const BaseLayer&);
+  BaseLayer& operator=(const BaseLayer&);
+};
+
+BaseLayer::BaseLayer() {
+  mode = BASELAYER_OFF;
+  rgb = NULL;
+  water = NULL;
+  lightfactor = NULL;
+  tx = NULL;
+  ty = NULL;
+  cloud = NULL;
+  cloudshade = NULL;
+}
+
+BaseLayer::~BaseLayer() {
+  release();
+}
+
+bool BaseLayer::init(int npixels) {
+  TRACE("baseLayer: init")
+
+  release();
+
+  size_t n = std::max(npixels,1);
+  rgb         = (unsigned char *)malloc(n*3*sizeof(unsigned char));
+  water       = (unsigned char *)malloc(n*sizeof(unsigned char));
+  lightfactor = (double *)malloc(n*sizeof(double));
+  tx          = (int *)malloc(n*sizeof(int));
+  ty          = (int *)malloc(n*sizeof(int));
+  cloud       = (float *)malloc(n*sizeof(float));
+  cloudshade  = (float *)malloc(n*sizeof(float));
+  if (rgb == NULL || water == NULL || lightfactor == NULL || tx == NULL || ty == NULL ||
+      cloud == NULL || cloudshade == NULL) {
+    std::cerr << "Warning: could not allocate base layer, continuing without" << std::endl;
+    release();
+    return false;
+  }
+  return true;
+}
+
+void BaseLayer::release() {
+  if (rgb != NULL) free(rgb);
+  if (water != NULL) free(water);
+  if (lightfactor != NULL) free(lightfactor);
+  if (tx != NULL) free(tx);
+  if (ty != NULL) free(ty);
+  if (cloud != NULL) free(cloud);
+  if (cloudshade != NULL) free(cloudshade);
+  rgb = NULL;
+  water = NULL;
+  lightfactor = NULL;
+  tx = NULL;
+  ty = NULL;
+  cloud = NULL;
+  cloudshade = NULL;
+  mode = BASELAYER_OFF;
+}
+
+#endif  // BASELAYER_H
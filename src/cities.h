@@ -562,7 +562,7 @@ void addCitiesToImage(unsigned char* imagebuffer,
                       unsigned char *halfimagebuffer,
                       float *halfCityDistances,
                       unsigned char * halfCityBoundingBoxes,
-                      bool rotateglobe,
+                      bool recheckframes,
                       double globe_radius_km,
                       unsigned char *textColor,
                       bool verbose=false,
@@ -581,7 +581,8 @@ void addCitiesToImage(unsigned char* imagebuffer,
   int cityBoundingBoxHeight = iceil(image_h/cityBoundingBoxFactorD);
 
   // re-evaluates overlapping city bounding boxes for each new frame
-  if (rotateglobe) { cityBoundingBoxesChecked = false; }
+  // (rotating globe, or frames not rendered in sequence)
+  if (recheckframes) { cityBoundingBoxesChecked = false; }
 
   // TODO-NOTE: block needs to be moved to separate file, and made
   // generic for w and halfWidth. only referred in two places! but
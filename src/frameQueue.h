@@ -0,0 +1,296 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// frameQueue.h
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+/* -----------------------------------------------------------------------------------------------
+
+frame queue
+
+ work queue in a spool directory on a shared file system. renderer processes on any number of
+ nodes take frames by creating a ticket file for it with O_EXCL, only one of them succeeds:
+
+   <spool>/<job>.<frame>.claim  - frame taken, file modification time is the heartbeat
+   <spool>/<job>.<frame>.done   - frame written (claim renamed when its images are written)
+
+ the job key is a hash of the render parameters, such that jobs with different parameters
+ (e.g. movie tags at several resolutions) can share the spool. tickets record frame, parameters,
+ host and process. a thread refreshes the heartbeat of all claims of this process; claims
+ without heartbeat for longer than the timeout are taken over by other processes.
+
+----------------------------------------------------------------------------------------------- */
+
+class FrameQueue {
+public:
+  FrameQueue();
+  ~FrameQueue();
+
+  bool init(const char *spooldir, const std::string &params, double timeout);
+  int  claim(const std::vector<int> &frames, int none, bool wait, bool verbose=false);
+  void done(int frame);
+  void release();
+
+  bool active() const { return spool.length() > 0; }
+
+  double timeout;
+
+private:
+  std::string spool;
+  std::string params;
+  std::string job;
+
+  // claims of this process, refreshed by heartbeat thread
+  std::vector<int> claims;
+  std::thread heartbeat;
+  std::mutex lock;
+  std::condition_variable changed;
+  bool stopping;
+
+  std::string ticketName(int frame, const char *state) const;
+  bool createTicket(int frame);
+  bool takeStaleTicket(int frame);
+  bool isStale(const char *filename) const;
+  void beat();
+
+  // not copyable (owns its thread)
+  FrameQueue(const FrameQueue&);
+  FrameQueue& operator=(const FrameQueue&);
+};
+
+FrameQueue::FrameQueue() {
+  timeout = 600.0;
+  stopping = false;
+}
+
+FrameQueue::~FrameQueue() {
+  release();
+}
+
+// sets spool directory and job key (from the render parameters)
+
+bool FrameQueue::init(const char *spooldir, const std::string &parameters, double timeoutsec) {
+  TRACE("frameQueue: init")
+
+  struct stat st;
+  if (stat(spooldir,&st) != 0 || ! S_ISDIR(st.st_mode)) {
+    std::cerr << "Error. queue spool directory " << spooldir << " not found. Exiting." << std::endl;
+    return false;
+  }
+
+  spool = spooldir;
+  params = parameters;
+  timeout = timeoutsec;
+
+  // job key: FNV-1a hash of parameters
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i=0; i<params.length(); i++) {
+    hash ^= (unsigned char)params[i];
+    hash *= 1099511628211ULL;
+  }
+  char key[32];
+  snprintf(key,sizeof(key),"%016llx",hash);
+  job = key;
+
+  std::cerr << "frame queue: " << spool << " job " << job << " (claims stale after " << timeout << " s)" << std::endl;
+  return true;
+}
+
+std::string FrameQueue::ticketName(int frame, const char *state) const {
+  char name[64];
+  snprintf(name,sizeof(name),"/%s.%06d.%s",job.c_str(),frame,state);
+  return spool + name;
+}
+
+bool FrameQueue::isStale(const char *filename) const {
+  struct stat st;
+  if (stat(filename,&st) != 0) return false;
+
+  struct timeval now;
+  gettimeofday(&now,NULL);
+  return (double)(now.tv_sec - st.st_mtime) > timeout;
+}
+
+// creates claim ticket, fails if frame is claimed already
+
+bool FrameQueue::createTicket(int frame) {
+  std::string claimname = ticketName(frame,"claim");
+
+  int fd = open(claimname.c_str(),O_CREAT|O_EXCL|O_WRONLY,0644);
+  if (fd < 0) return false;
+
+  char host[256];
+  if (gethostname(host,sizeof(host)) != 0) strcpy(host,"unknown");
+  host[sizeof(host)-1] = '\0';
+
+  struct timeval now;
+  gettimeofday(&now,NULL);
+
+  std::string ticket = "frame " + std::to_string(frame) + "\n"
+                     + "parameters " + params + "\n"
+                     + "host " + host + " pid " + std::to_string((long)getpid()) + "\n"
+                     + "claimed " + std::to_string((long)now.tv_sec) + "\n";
+  ssize_t written = write(fd,ticket.c_str(),ticket.length());
+  close(fd);
+  if (written != (ssize_t)ticket.length()) {
+    std::cerr << "Warning: could not write queue ticket " << claimname << std::endl;
+  }
+  return true;
+}
+
+// removes stale claim ticket of frame, such that it can be claimed again
+//
+// note: the stale ticket gets renamed first, so that only one process removes it.
+//       in case the renamed ticket is not stale anymore (it was claimed again meanwhile), it gets put back.
+
+bool FrameQueue::takeStaleTicket(int frame) {
+  std::string claimname = ticketName(frame,"claim");
+  if (! isStale(claimname.c_str())) return false;
+
+  char host[256];
+  if (gethostname(host,sizeof(host)) != 0) strcpy(host,"unknown");
+  host[sizeof(host)-1] = '\0';
+  std::string stalename = claimname + ".stale." + host + "." + std::to_string((long)getpid());
+
+  if (rename(claimname.c_str(),stalename.c_str()) != 0) return false;
+
+  if (! isStale(stalename.c_str())) {
+    if (link(stalename.c_str(),claimname.c_str()) != 0) {
+      std::cerr << "Warning: could not restore queue ticket " << claimname << std::endl;
+    }
+    unlink(stalename.c_str());
+    return false;
+  }
+  unlink(stalename.c_str());
+
+  std::cerr << "frame queue: frame " << frame << " claim stale, taking over" << std::endl;
+  return true;
+}
+
+// claims next frame of frames, returns none if there is none left to claim
+//
+// with wait, it waits while frames are claimed by other processes (until done or stale), and returns
+// none when all frames are done or claimed by this process.
+// note: wait only while not rendering a claimed frame, otherwise processes could wait for each other.
+
+int FrameQueue::claim(const std::vector<int> &frames, int none, bool wait, bool verbose) {
+  TRACE("frameQueue: claim")
+
+  // heartbeat of claims
+  if (! heartbeat.joinable()) {
+    stopping = false;
+    heartbeat = std::thread(&FrameQueue::beat,this);
+  }
+
+  while (true) {
+    bool pending = false;
+
+    for (size_t n=0; n<frames.size(); n++) {
+      int frame = frames[n];
+
+      // frame written
+      if (access(ticketName(frame,"done").c_str(),F_OK) == 0) continue;
+
+      // frame claimed by this process (being written)
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        if (std::find(claims.begin(),claims.end(),frame) != claims.end()) continue;
+      }
+
+      // claims frame
+      if (createTicket(frame) || (takeStaleTicket(frame) && createTicket(frame))) {
+        // frame might have been finished in the meantime
+        if (access(ticketName(frame,"done").c_str(),F_OK) == 0) {
+          unlink(ticketName(frame,"claim").c_str());
+          continue;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        claims.push_back(frame);
+        if (verbose) std::cerr << "frame queue: claimed frame " << frame << std::endl;
+        return frame;
+      }
+      pending = true;
+    }
+
+    // all frames done
+    if (! pending || ! wait) return none;
+
+    // waits for other processes to finish their frames (or to go stale)
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait_for(guard,std::chrono::milliseconds((int)std::min(1000.0,timeout*250.0)+1));
+  }
+}
+
+// marks frame as written
+
+void FrameQueue::done(int frame) {
+  TRACE("frameQueue: done")
+
+  std::lock_guard<std::mutex> guard(lock);
+  for (size_t n=0; n<claims.size(); n++) {
+    if (claims[n] == frame) {
+      claims.erase(claims.begin()+n);
+      break;
+    }
+  }
+  if (rename(ticketName(frame,"claim").c_str(),ticketName(frame,"done").c_str()) != 0) {
+    std::cerr << "Warning: could not mark frame " << frame << " done in queue" << std::endl;
+  }
+}
+
+// refreshes modification time of claim tickets
+
+void FrameQueue::beat() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (! stopping) {
+    changed.wait_for(guard,std::chrono::milliseconds((int)(timeout*250.0)+1),[this]{ return stopping; });
+    for (size_t n=0; n<claims.size(); n++) utimes(ticketName(claims[n],"claim").c_str(),NULL);
+  }
+}
+
+// stops heartbeat (remaining claims go stale and get taken over by others)
+
+void FrameQueue::release() {
+  if (heartbeat.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+      changed.notify_all();
+    }
+    heartbeat.join();
+  }
+  claims.clear();
+}
+
+#endif  // FRAMEQUEUE_H
@@ -16,10 +16,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <math.h>
+#include <zlib.h>
+
+#include "waveContainer.h"
 
 // Output format is:
 //
@@ -38,146 +45,342 @@
 //    {
 //      (float) v
 //    }*npts
+//
+// quads:             // with option -q ngll, element connectivity for renderOnSphere -connectivity
+//    {
+//      (int) i0, i1, i2, i3   // 0-based point indices around the face
+//    }*nquads
+//
+// or, with option -o file, a single container file holding all of the above (see waveContainer.h)
 
 typedef struct xy_tag { float x,y; } XY;
 
 char* path = NULL;
 
-/* ----------------------------------------------------------------------------------------------- */
+// number of fortran records decoded per gzread() call
+#define RECORDS_PER_CHUNK 65536
 
-int readFrame(char* fn,XY* xys,float* vs, int is_data) {
-  char cmd[512];
-  int ret;
+/* ----------------------------------------------------------------------------------------------- */
 
-  unlink("frametmp");
-  //sprintf(cmd,"gzip -dc %s%s > frametmp ; ls -lsa frametmp",path,fn);
-  sprintf(cmd,"gzip -dc %s%s.gz > frametmp",path,fn);
-  printf("Uncompressing: %s\n",cmd);
+// opens packet file for streaming, compressed (fn.gz) or uncompressed (fn)
 
-  ret = system(cmd);
-  if(ret > 0) {
-    fprintf(stderr,"genDataFromBin: command failed: %s\n",cmd);
-    fprintf(stderr,"genDataFromBin: system() failed.\n");
-    unlink("frametmp");
+gzFile openPacket(char* fn, char* filename) {
+  sprintf(filename,"%s%s.gz",path,fn);
+  gzFile gz = gzopen(filename,"rb");
+  if(gz == NULL) {
+    // zlib reads uncompressed files transparently
+    sprintf(filename,"%s%s",path,fn);
+    gz = gzopen(filename,"rb");
+  }
+  if(gz == NULL) {
+    fprintf(stderr,"genDataFromBin: failed to open %s%s.gz\n",path,fn);
     exit(1);
   }
+  gzbuffer(gz,256*1024);
+  printf("Uncompressing: %s\n",filename);
+  return gz;
+}
 
-//  sprintf(cmd,"%s%s",path,fn);
+// reads next chunk of fortran records, returns number of complete records
 
-  int io = open("frametmp",O_RDONLY);
-  if(io < 0) {
-    printf("Failed to open %s\n",cmd);
-    unlink("frametmp");
+int readRecords(gzFile gz, char* filename, int* rec, int recsize, long* bs) {
+  int ret = gzread(gz,rec,RECORDS_PER_CHUNK*recsize);
+  if(ret < 0) {
+    int err;
+    fprintf(stderr,"genDataFromBin: read error %s: %s\n",filename,gzerror(gz,&err));
     exit(1);
   }
-
-  struct stat s;
-  if(stat("frametmp",&s) < 0) {
-    perror("genDataFromBin: stat(frametmp) failed");
-    unlink("frametmp");
+  if(ret % recsize != 0) {
+    fprintf(stderr,"Expected %s to be multiple of %d; was %ld.\n",filename,recsize,*bs+ret);
     exit(1);
   }
+  *bs += ret;
+  return ret/recsize;
+}
 
-  int bs = s.st_size;
-  // data files: have to contain 3 component values, e.g.  velocity E, N and Z
-  if( is_data == 1 ){
-    if((bs/3)*3 != bs) {
-      fprintf(stderr,"Expected .d file system to be multiple of 3; was %d.\n",bs);
-      unlink("frametmp");
-      exit(1);
+// uncompressed size of opened packet file: file size, or for .gz files the size stored in the
+// gzip trailer (modulo 2^32 as by the gzip format)
+
+long packetBytes(char* filename) {
+  size_t len = strlen(filename);
+  if(len > 3 && strcmp(filename+len-3,".gz") == 0) {
+    FILE* fp = fopen(filename,"rb");
+    unsigned char isize[4];
+    long bytes = -1;
+    if(fp != NULL && fseek(fp,-4,SEEK_END) == 0 && fread(isize,1,4,fp) == 4) {
+      bytes = (long)isize[0] | (long)isize[1] << 8 | (long)isize[2] << 16 | (long)isize[3] << 24;
     }
+    if(fp != NULL) fclose(fp);
+    return bytes;
   }
+  struct stat st;
+  if(stat(filename,&st) != 0) return -1;
+  return (long)st.st_size;
+}
 
-  char* b = (char*)malloc(bs);
-  if(read(io,b,bs) != bs) {
-    perror("genDataFromBin: read error");
-    unlink("frametmp");
+void checkRecordBoundary(int marker, int expected) {
+  if(marker != expected) {
+    fprintf(stderr,"Expected fortran record boundary to ==%d, but it's %d\n",expected,marker);
     exit(1);
   }
-  printf("Read: %d\n",bs);
-  close(io);
-  unlink("frametmp");
-
-  if(vs) {
-    int ptsThere = bs/(2*sizeof(int)+sizeof(float));
-    float* bf = (float*)b;
-    for(int i=0;i<ptsThere;i++) {
-      if(*(int*)bf != 4) {
-        fprintf(stderr,"Expected fortran record boundary to ==4, but it's %d\n",*(int*)bf);
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// reads grid points from bin_movie.xy, records: { (int) 8, (float) y, (float) x, (int) 8 }
+// returns number of points, xys gets allocated for the number of records in the file
+
+int readGrid(char* fn, XY** xys) {
+  char filename[512];
+  int recsize = 2*sizeof(int)+2*sizeof(float);
+  int* rec = (int*)malloc(RECORDS_PER_CHUNK*recsize);
+  int npts = 0;
+  int size = 0;
+  long bs = 0;
+
+  gzFile gz = openPacket(fn,filename);
+
+  // number of records from uncompressed size (a hint only: the gzip trailer holds the size of the
+  // last member modulo 4 GB)
+  long bytes = packetBytes(filename);
+  if(bytes > 0) {
+    size = (int)(bytes/recsize);
+    *xys = (XY*)malloc(sizeof(XY)*(size > 0 ? size : 1));
+    if(*xys == NULL) {
+      fprintf(stderr,"Error: allocating %d points\n",size);
+      exit(1);
+    }
+  }
+
+  int nrec;
+  while((nrec = readRecords(gz,filename,rec,recsize,&bs)) > 0) {
+    if(npts+nrec > size) {
+      // size unknown or too small, grows geometrically
+      size = 2*(npts+nrec);
+      *xys = (XY*)realloc(*xys,sizeof(XY)*size);
+      if(*xys == NULL) {
+        fprintf(stderr,"Error: allocating %d points\n",size);
         exit(1);
       }
-      bf++;
-      *(vs+i) = (float)(*bf);
-      //printf("%lf\n",*(vs+i));
-      bf++;
-      if(*(int*)bf != 4) {
-        fprintf(stderr,"Expected fortran record boundary to ==4, but it's %d\n",*(int*)bf);
-        exit(1);
+    }
+    int* r = rec;
+    for(int i=0;i<nrec;i++,r+=4) {
+      checkRecordBoundary(r[0],8);
+      memcpy(&((*xys)+npts+i)->y,r+1,sizeof(float));
+      memcpy(&((*xys)+npts+i)->x,r+2,sizeof(float));
+      checkRecordBoundary(r[3],8);
+    }
+    npts += nrec;
+  }
+  gzclose(gz);
+  free(rec);
+
+  printf("Read: %ld\n",bs);
+  return npts;
+}
+
+// reads wavefield values from bin_movie_******.d, records: { (int) 4, (float) v, (int) 4 }
+// decodes through the record buffer rec (RECORDS_PER_CHUNK records), uncompressed size returned in bs
+// returns number of points, at most npts values are stored in vs
+
+int readFrame(char* fn, float* vs, int npts, int* rec, long* bs) {
+  char filename[512];
+  int recsize = 2*sizeof(int)+sizeof(float);
+  int ptsThere = 0;
+
+  *bs = 0;
+  gzFile gz = openPacket(fn,filename);
+
+  int nrec;
+  while((nrec = readRecords(gz,filename,rec,recsize,bs)) > 0) {
+    int* r = rec;
+    for(int i=0;i<nrec;i++,r+=3) {
+      checkRecordBoundary(r[0],4);
+      if(ptsThere+i < npts) memcpy(vs+ptsThere+i,r+1,sizeof(float));
+      checkRecordBoundary(r[2],4);
+    }
+    ptsThere += nrec;
+  }
+  gzclose(gz);
+
+  printf("Read: %ld\n",*bs);
+  return ptsThere;
+}
+
+
+/* -----------------------------------------------------------------------------------------------
+
+frame extraction workers
+
+ each worker owns its value and record buffers and picks the next frame from a shared counter.
+ frames are written to their own files, so the output does not depend on the number of workers.
+
+----------------------------------------------------------------------------------------------- */
+
+typedef struct worker_tag {
+  float* vs;
+  int*   rec;
+  int    nframes;
+  long   bytes_in;
+  long   bytes_out;
+  // encoded frame and error statistics against float32 values
+  unsigned char* encoded;
+  float* decoded;
+  double maxerr;
+  double sumsqerr;
+} Worker;
+
+// writes connectivity of the movie points to file quads. SPECFEM stores the surface movie points
+// element by element, ngll x ngll points per element face (i running fastest), or only the 2 x 2
+// corners for coarse movies (ngll = 2). each element face gives (ngll-1)^2 quads.
+
+void writeQuads(char* fn, int npts, int ngll) {
+  int nelem = npts/(ngll*ngll);
+  if(ngll < 2 || nelem*ngll*ngll != npts) {
+    fprintf(stderr,"Error: %d points are no elements of %d x %d points\n",npts,ngll,ngll);
+    exit(1);
+  }
+  int nquads = nelem*(ngll-1)*(ngll-1);
+  int* quads = (int*)malloc(sizeof(int)*4*nquads);
+  if(quads == NULL) {
+    fprintf(stderr,"Error: allocating %d quads\n",nquads);
+    exit(1);
+  }
+  int* q = quads;
+  for(int e=0;e<nelem;e++) {
+    int base = e*ngll*ngll;
+    for(int j=0;j<ngll-1;j++) {
+      for(int i=0;i<ngll-1;i++,q+=4) {
+        q[0] = base + j*ngll + i;
+        q[1] = base + j*ngll + i+1;
+        q[2] = base + (j+1)*ngll + i+1;
+        q[3] = base + (j+1)*ngll + i;
       }
-      bf++;
     }
-    free(b);
-    return ptsThere;
   }
 
-  if(xys) {
-    int ptsThere = bs/(2*sizeof(int)+2*sizeof(float));
-    float* bf = (float*)b;
-    for(int i=0;i<ptsThere;i++) {
-      if(*(int*)bf != 8) {
-        fprintf(stderr,"Expected fortran record boundary to ==4, but it's %d\n",*(int*)bf);
+  unlink(fn);
+  int o = open(fn,O_WRONLY|O_CREAT|O_TRUNC,0644);
+  if(write(o,quads,sizeof(int)*4*nquads) != sizeof(int)*4*nquads) {
+    fprintf(stderr,"Error: writing quads");
+    perror("");
+    exit(1);
+  }
+  close(o);
+  free(quads);
+  printf("Wrote %d quads of %d elements to %s\n",nquads,nelem,fn);
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+int npts = 0;
+int num = 0;
+int interval = 0;
+int start_num = 0;
+int show_timing = 0;
+
+// container output
+int container_fd = -1;
+WaveContainerHeader container_header;
+
+int next_frame = 0;
+pthread_mutex_t frame_lock = PTHREAD_MUTEX_INITIALIZER;
+
+double wtime() {
+  struct timeval t;
+  gettimeofday(&t,NULL);
+  return (double)t.tv_sec + (double)t.tv_usec*1.e-6;
+}
+
+void* extractFrames(void* arg) {
+  Worker* w = (Worker*)arg;
+
+  while(1) {
+    pthread_mutex_lock(&frame_lock);
+    int i = next_frame++;
+    pthread_mutex_unlock(&frame_lock);
+    if(i >= start_num+num) break;
+
+    double t0 = wtime();
+
+    char fn[512];
+    // frame id
+    // example: starts at frame 7000, every 100 -> id = 70
+    int id = i + 1;
+    sprintf(fn,"bin_movie_%06d.d",id*interval);
+    printf("Reading vs from frame %d...\n",id);
+
+    long bs;
+    int cp = readFrame(fn,w->vs,npts,w->rec,&bs);
+    if(npts != cp) {
+      fprintf(stderr,"Error: Expected %d pts in frame %d, got %d\n",npts,id,cp);
+      exit(1);
+    }
+
+    double t1 = wtime();
+
+    // output id: starts at 0, thus start frame becomes 0
+    int id_out = i - start_num;
+
+    long bytes_out = npts*sizeof(float);
+
+    if(container_fd >= 0) {
+      // frames have fixed slots in the container
+      WaveContainerFrame frame = waveContainerFrame(&container_header,id_out);
+      const void* payload = w->vs;
+      if(container_header.encoding != WAVE_ENCODING_FLOAT32) {
+        waveEncodeFrame(container_header.encoding,w->vs,npts,w->encoded);
+        payload = w->encoded;
+
+        // error against float32 values, relative to frame maximum
+        waveDecodeFrame(container_header.encoding,w->encoded,npts,w->decoded);
+        double vmax = 0.0, maxerr = 0.0, sumsqerr = 0.0;
+        for(int k=0;k<npts;k++) {
+          double v = fabs((double)w->vs[k]);
+          double err = fabs((double)w->decoded[k] - (double)w->vs[k]);
+          if(v > vmax) vmax = v;
+          if(err > maxerr) maxerr = err;
+          sumsqerr += err*err;
+        }
+        if(vmax > 0.0) {
+          maxerr /= vmax;
+          sumsqerr /= vmax*vmax;
+        }
+        printf("Encoding: frame %d: %s max error %.3e rms error %.3e (relative to max |v| = %e)\n",
+               id,waveEncodingName(container_header.encoding),maxerr,sqrt(sumsqerr/npts),vmax);
+        if(maxerr > w->maxerr) w->maxerr = maxerr;
+        w->sumsqerr += sumsqerr;
+      }
+      if(pwrite(container_fd,payload,frame.size,frame.offset) != frame.size) {
+        fprintf(stderr,"Error: writing vs for frame %d",id);
+        perror("");
         exit(1);
       }
-      bf++;
-      (xys+i)->y=(float)(*bf);
-      bf++;
-      (xys+i)->x=(float)(*bf);
-      bf++;
-      //printf("%lf %lf\n",(xys+i)->x,(xys+i)->y);
-      if(*(int*)bf != 8) {
-        fprintf(stderr,"Expected fortran record boundary to ==4, but it's %d\n",*(int*)bf);
+      bytes_out = frame.size;
+    } else {
+      sprintf(fn,"%06d.v",id_out);
+      unlink(fn);
+      int o = open(fn,O_WRONLY|O_CREAT|O_TRUNC,0644);
+      if(write(o,w->vs,npts*sizeof(float)) != npts*sizeof(float)) {
+        fprintf(stderr,"Error: writing vs for frame %d",id);
+        perror("");
         exit(1);
       }
-      bf++;
+      close(o);
     }
-    free(b);
-    return ptsThere;
-  }
 
-  free(b);
-  return bs/(2*sizeof(int)+2*sizeof(float));   // Both null is reading xy
-
-#if 0
-  char cmd[512];
-  unlink("frametmp");
-  sprintf(cmd,"gzip -dc %s%s > frametmp",path,fn);
-  system(cmd);
-  FILE* io = fopen("frametmp","r");
-
-  int numpts = 0;
-  float x,y,v;
-  while(!feof(io)) {
-    int rc = fscanf(io,"%lf %lf %lf",&x,&y,&v);
-    if(rc == -1) {
-      if(!ferror(io)) break;        // EOF
-      perror("Error: fscanf");
-      unlink("frametmp");
-      exit(1);
-    }
-    if(rc != 3) {
-      fprintf(stderr,"Error: frame %s is malformed (fscanf %d!=3)\n",fn);
-      unlink("frametmp");
-      exit(1);
+    double t2 = wtime();
+
+    w->nframes++;
+    w->bytes_in += bs;
+    w->bytes_out += bytes_out;
+
+    if(show_timing) {
+      printf("Timing: frame %d: %.3f s (decode %.3f s, write %.3f s), %.1f MB/s\n",
+             id,t2-t0,t1-t0,t2-t1,(double)bs/(1024.0*1024.0)/(t2-t0));
     }
-    if(xys) { (xys+numpts)->x=x; (xys+numpts)->y=y; }
-    if(vs) *(vs+numpts)=v;
-    numpts++;
   }
-
-  fclose(io);
-  unlink("frametmp");
-  return numpts;
-#endif
+  return NULL;
 }
 
 
@@ -189,81 +392,196 @@ main routine
 
 int main(int argc,char** argv) {
 
+  int nworkers = 1;
+  char* container = NULL;
+  int encoding = WAVE_ENCODING_FLOAT32;
+  int ngll = 0;
+
+  // options
+  int opt;
+  while((opt = getopt(argc,argv,"e:j:o:q:t")) != -1) {
+    switch(opt) {
+      case 'e': encoding = waveEncodingFromName(optarg); break;
+      case 'j': nworkers = atoi(optarg); break;
+      case 'o': container = optarg; break;
+      case 'q': ngll = atoi(optarg); break;
+      case 't': show_timing = 1; break;
+      default:
+        fprintf(stderr,"Usage: genDataFromBin [-j nworkers] [-o container] [-e encoding] [-q ngll] [-t] <packetDirectory> <num> <interval> <(optional)start_num>\n");
+        exit(2);
+    }
+  }
+  if(nworkers < 1) nworkers = 1;
+
   // usage
-  if(argc<4) {
-    fprintf(stderr,"Usage: genDataFromBin <packetDirectory> <num> <interval> <(optional)start_num>\n");
+  int nargs = argc-optind;
+  if(nargs<3 || encoding < 0 || (encoding != WAVE_ENCODING_FLOAT32 && container == NULL)) {
+    fprintf(stderr,"Usage: genDataFromBin [-j nworkers] [-o container] [-e encoding] [-q ngll] [-t] <packetDirectory> <num> <interval> <(optional)start_num>\n");
+    fprintf(stderr,"  -j nworkers   extract frames with nworkers threads\n");
+    fprintf(stderr,"  -o container  write single container file instead of n, xy and NNNNNN.v files\n");
+    fprintf(stderr,"  -e encoding   container frame encoding: float32 (default), float16 or log12 (lossy)\n");
+    fprintf(stderr,"  -q ngll       write element connectivity to file quads (ngll points per element edge, 2 for coarse movies)\n");
+    fprintf(stderr,"  -t            print timing per frame\n");
     exit(2);
   }
 
   // arguments
-  path = argv[1];
-  int num = atoi(argv[2]);
-  int interval = atoi(argv[3]);
+  path = argv[optind];
+  num = atoi(argv[optind+1]);
+  interval = atoi(argv[optind+2]);
 
-  int start_num = 0;
-  if(argc == 5) { start_num = atoi(argv[4]); }
+  if(nargs == 4) { start_num = atoi(argv[optind+3]); }
 
-  int npts = 0;
   char fn[512];
-  int ret;
+
+  double t0 = wtime();
 
   //sprintf(fn,"bin_movie.xy",interval);
   sprintf(fn,"bin_movie.xy");
-  printf("Reading npts from %s...\n",fn);
+  printf("Reading grid from %s...\n",fn);
 
-  npts = readFrame(fn,NULL,NULL,0);
+  XY* xys0 = NULL;
+  npts = readGrid(fn,&xys0);
   printf("(%d points)\n",npts);
-  {
-    int o = open("n",O_WRONLY|O_CREAT|O_TRUNC,0644);
-    ret = write(o,&npts,sizeof(npts));
-    ret = write(o,&num,sizeof(num));
-    ret = write(o,&interval,sizeof(interval));
-    close(o);
-  }
 
-  XY* xys0 = (XY*)malloc(sizeof(XY)*npts);
-  printf("Reading grid from xy...\n");
+  if(container != NULL) {
+    // container: header, coordinates and frame table, frames get filled in by the workers
+    waveContainerLayout(&container_header,npts,num,interval,start_num,encoding);
+    WaveContainerFrame last = waveContainerFrame(&container_header,num);
+
+    printf("Writing container %s (%d frames, %s, %.1f MB)\n",container,num,waveEncodingName(encoding),
+           (double)last.offset/(1024.0*1024.0));
 
-  ret = readFrame(fn,xys0,NULL,0);
-  if (ret != 0){
-    sprintf(fn,"xy");
-    unlink(fn);
-    int o = open(fn,O_WRONLY|O_CREAT|O_TRUNC,0644);
-    if(write(o,xys0,npts*sizeof(XY)) != npts*sizeof(XY)) {
-      fprintf(stderr,"Error: writing xys");
+    unlink(container);
+    container_fd = open(container,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(container_fd < 0 || ftruncate(container_fd,last.offset) != 0) {
+      fprintf(stderr,"Error: creating container %s",container);
       perror("");
       exit(1);
     }
-    close(o);
-  }
 
-  float* vs = (float*)malloc(sizeof(float)*npts);
+    WaveContainerFrame* table = (WaveContainerFrame*)malloc(num*sizeof(WaveContainerFrame));
+    for(int k=0;k<num;k++) table[k] = waveContainerFrame(&container_header,k);
 
-  for(int i=start_num;i<start_num+num;i++) {
-    char fn[512];
-    // frame id
-    // example: starts at frame 7000, every 100 -> id = 70
-    int id = i + 1;
-    sprintf(fn,"bin_movie_%06d.d",id*interval);
-    printf("Reading vs from frame %d...\n",id);
+    if(pwrite(container_fd,&container_header,sizeof(container_header),0) != sizeof(container_header)
+       || pwrite(container_fd,xys0,npts*sizeof(XY),container_header.coords_offset) != npts*sizeof(XY)
+       || pwrite(container_fd,table,num*sizeof(WaveContainerFrame),container_header.table_offset) != num*sizeof(WaveContainerFrame)) {
+      fprintf(stderr,"Error: writing container %s",container);
+      perror("");
+      exit(1);
+    }
+    free(table);
+
+  } else {
+    {
+      int header[3] = { npts, num, interval };
+      int o = open("n",O_WRONLY|O_CREAT|O_TRUNC,0644);
+      if(write(o,header,sizeof(header)) != sizeof(header)) {
+        fprintf(stderr,"Error: writing n");
+        perror("");
+        exit(1);
+      }
+      close(o);
+    }
 
-    int cp = readFrame(fn,NULL,vs,1);
-    if(npts != cp) {
-      fprintf(stderr,"Error: Expected %d pts in frame %d, got %d\n",npts,id,cp);
+    if (npts != 0){
+      sprintf(fn,"xy");
+      unlink(fn);
+      int o = open(fn,O_WRONLY|O_CREAT|O_TRUNC,0644);
+      if(write(o,xys0,npts*sizeof(XY)) != npts*sizeof(XY)) {
+        fprintf(stderr,"Error: writing xys");
+        perror("");
+        exit(1);
+      }
+      close(o);
+    }
+  }
+  free(xys0);
+
+  if(ngll > 0) writeQuads("quads",npts,ngll);
+
+  // frame extraction
+  if(nworkers > num) nworkers = num;
+  if(nworkers < 1) nworkers = 1;
+  if(nworkers > 1) printf("Extracting %d frames with %d workers\n",num,nworkers);
+
+  double t1 = wtime();
+
+  Worker* workers = (Worker*)calloc(nworkers,sizeof(Worker));
+  pthread_t* threads = (pthread_t*)malloc(nworkers*sizeof(pthread_t));
+  for(int k=0;k<nworkers;k++) {
+    workers[k].vs = (float*)malloc(sizeof(float)*npts);
+    workers[k].rec = (int*)malloc(RECORDS_PER_CHUNK*(2*sizeof(int)+sizeof(float)));
+    if(encoding != WAVE_ENCODING_FLOAT32) {
+      workers[k].encoded = (unsigned char*)malloc(waveContainerFrameSize(encoding,npts));
+      workers[k].decoded = (float*)malloc(sizeof(float)*npts);
+      if(workers[k].encoded == NULL || workers[k].decoded == NULL) {
+        fprintf(stderr,"Error: allocating buffers for worker %d\n",k);
+        exit(1);
+      }
+    }
+    if(workers[k].vs == NULL || workers[k].rec == NULL) {
+      fprintf(stderr,"Error: allocating buffers for worker %d\n",k);
       exit(1);
     }
+  }
 
-    // output id: starts at 0, thus start frame becomes 0
-    int id_out = i - start_num;
+  next_frame = start_num;
+  if(nworkers == 1) {
+    extractFrames(&workers[0]);
+  } else {
+    for(int k=0;k<nworkers;k++) {
+      if(pthread_create(&threads[k],NULL,extractFrames,&workers[k]) != 0) {
+        perror("genDataFromBin: pthread_create failed");
+        exit(1);
+      }
+    }
+    for(int k=0;k<nworkers;k++) pthread_join(threads[k],NULL);
+  }
 
-    sprintf(fn,"%06d.v",id_out);
-    unlink(fn);
-    int o = open(fn,O_WRONLY|O_CREAT|O_TRUNC,0644);
-    if(write(o,vs,npts*sizeof(float)) != npts*sizeof(float)) {
-      fprintf(stderr,"Error: writing vs for frame %d",id);
-      perror("");
-      exit(1);
+  double t2 = wtime();
+
+  if(show_timing) {
+    long bytes_in = 0, bytes_out = 0;
+    int nframes = 0;
+    for(int k=0;k<nworkers;k++) {
+      nframes += workers[k].nframes;
+      bytes_in += workers[k].bytes_in;
+      bytes_out += workers[k].bytes_out;
+    }
+    double mb_in = (double)bytes_in/(1024.0*1024.0);
+    double mb_out = (double)bytes_out/(1024.0*1024.0);
+    printf("Timing: grid %.3f s\n",t1-t0);
+    printf("Timing: %d frames in %.3f s with %d workers (%.3f s per frame)\n",
+           nframes,t2-t1,nworkers,nframes > 0 ? (t2-t1)/nframes : 0.0);
+    printf("Timing: decoded %.1f MB, written %.1f MB, aggregate %.1f MB/s decoded, %.1f MB/s written\n",
+           mb_in,mb_out,mb_in/(t2-t1),mb_out/(t2-t1));
+  }
+
+  // encoding error summary
+  if(encoding != WAVE_ENCODING_FLOAT32) {
+    double maxerr = 0.0, sumsqerr = 0.0;
+    int nframes = 0;
+    for(int k=0;k<nworkers;k++) {
+      if(workers[k].maxerr > maxerr) maxerr = workers[k].maxerr;
+      sumsqerr += workers[k].sumsqerr;
+      nframes += workers[k].nframes;
     }
-    close(o);
+    printf("Encoding: %s, %.1f%% of float32 size, max error %.3e rms error %.3e (relative to frame max |v|)\n",
+           waveEncodingName(encoding),
+           100.0*(double)waveContainerFrameSize(encoding,npts)/(double)waveContainerFrameSize(WAVE_ENCODING_FLOAT32,npts),
+           maxerr,nframes > 0 ? sqrt(sumsqerr/((double)nframes*npts)) : 0.0);
+  }
+
+  if(container_fd >= 0) close(container_fd);
+
+  for(int k=0;k<nworkers;k++) {
+    free(workers[k].vs);
+    free(workers[k].rec);
+    free(workers[k].encoded);
+    free(workers[k].decoded);
   }
+  free(workers);
+  free(threads);
+  return 0;
 }
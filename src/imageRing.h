@@ -0,0 +1,228 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// imageRing.h
+#ifndef IMAGERING_H
+#define IMAGERING_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+/* -----------------------------------------------------------------------------------------------
+
+image ring
+
+ ring of image buffers between the rendering and the output stage of the frame loop.
+ a rendered frame gets queued together with the frame state its annotation needs, and an output
+ thread creates the half image, annotates, encodes and writes it, while the next frame renders
+ into the next free buffer. with a single buffer, frames get written right away on the calling
+ thread.
+
+----------------------------------------------------------------------------------------------- */
+
+struct FrameImage {
+  // image buffers
+  unsigned char *image;
+  unsigned char *halfimage;
+
+  // frame state for annotation
+  int    nframe;
+  int    iinterlace;
+  int    frame_number;
+  double maxScale;
+
+  // city label state (copied from renderer, annotation may change distances)
+  float *cityDistances;
+  int   *cityPositionX;
+  int   *cityPositionY;
+};
+
+class ImageRing {
+public:
+  ImageRing();
+  ~ImageRing();
+
+  bool init(int nbuffers, size_t imagesize, size_t halfimagesize);
+  void start(std::function<int(FrameImage&)> output);
+  FrameImage* acquire();
+  void submit(FrameImage *frame);
+  int  finish();
+  void release();
+
+  int size() const { return (int)frames.size(); }
+
+private:
+  std::vector<FrameImage> frames;
+
+  // output stage
+  std::function<int(FrameImage&)> output;
+  std::thread worker;
+  std::mutex lock;
+  std::condition_variable changed;
+
+  std::deque<FrameImage*> queued;   // rendered, waiting for output
+  std::deque<FrameImage*> available; // written, free for rendering
+  bool stopping;
+  int  error;
+
+  void run();
+
+  // not copyable (owns its buffers and thread)
+  ImageRing(const ImageRing&);
+  ImageRing& operator=(const ImageRing&);
+};
+
+ImageRing::ImageRing() {
+  stopping = false;
+  error = 0;
+}
+
+ImageRing::~ImageRing() {
+  release();
+}
+
+// allocates image buffers (halfimagesize zero for no half images)
+
+bool ImageRing::init(int nbuffers, size_t imagesize, size_t halfimagesize) {
+  TRACE("imageRing: init")
+
+  release();
+  if (nbuffers < 1) nbuffers = 1;
+
+  frames.resize(nbuffers);
+  for (int n=0; n<nbuffers; n++) {
+    FrameImage &frame = frames[n];
+    memset(&frame,0,sizeof(FrameImage));
+    frame.image = (unsigned char*)calloc(imagesize,1);
+    if (frame.image == NULL) {
+      std::cerr << "Error. could not allocate image buffer. Exiting." << std::endl;
+      return false;
+    }
+    if (halfimagesize > 0){
+      frame.halfimage = (unsigned char*)malloc(halfimagesize);
+      if (frame.halfimage == NULL) {
+        std::cerr << "Error. could not allocate half image buffer. Exiting." << std::endl;
+        return false;
+      }
+    }
+    available.push_back(&frame);
+  }
+  return true;
+}
+
+// sets output stage, starts output thread for more than a single buffer
+
+void ImageRing::start(std::function<int(FrameImage&)> out) {
+  TRACE("imageRing: start")
+
+  output = out;
+  if (frames.size() > 1 && ! worker.joinable()) worker = std::thread(&ImageRing::run,this);
+}
+
+// next free image buffer, waits for output stage to write one if needed
+// returns NULL after an output error
+
+FrameImage* ImageRing::acquire() {
+  TRACE("imageRing: acquire")
+
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard,[this]{ return ! available.empty() || error != 0; });
+  if (error != 0) return NULL;
+
+  FrameImage *frame = available.front();
+  available.pop_front();
+  return frame;
+}
+
+// hands rendered frame to output stage
+
+void ImageRing::submit(FrameImage *frame) {
+  TRACE("imageRing: submit")
+
+  if (! worker.joinable()) {
+    int ret = output(*frame);
+    std::lock_guard<std::mutex> guard(lock);
+    if (ret != 0 && error == 0) error = ret;
+    available.push_back(frame);
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  queued.push_back(frame);
+  changed.notify_all();
+}
+
+void ImageRing::run() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    changed.wait(guard,[this]{ return ! queued.empty() || stopping; });
+    if (queued.empty()) break;
+
+    FrameImage *frame = queued.front();
+    queued.pop_front();
+
+    int ret = 0;
+    if (error == 0) {
+      guard.unlock();
+      ret = output(*frame);
+      guard.lock();
+    }
+
+    if (ret != 0 && error == 0) error = ret;
+    available.push_back(frame);
+    changed.notify_all();
+  }
+}
+
+// waits for all queued frames to be written, returns first output error
+
+int ImageRing::finish() {
+  TRACE("imageRing: finish")
+
+  if (worker.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+      changed.notify_all();
+    }
+    worker.join();
+  }
+  stopping = false;
+  return error;
+}
+
+void ImageRing::release() {
+  finish();
+
+  for (size_t n=0; n<frames.size(); n++) {
+    FrameImage &frame = frames[n];
+    if (frame.image != NULL) free(frame.image);
+    if (frame.halfimage != NULL) free(frame.halfimage);
+    if (frame.cityDistances != NULL) free(frame.cityDistances);
+    if (frame.cityPositionX != NULL) free(frame.cityPositionX);
+    if (frame.cityPositionY != NULL) free(frame.cityPositionY);
+  }
+  frames.clear();
+  queued.clear();
+  available.clear();
+  error = 0;
+}
+
+#endif  // IMAGERING_H
@@ -0,0 +1,103 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// pixelContext.h
+#ifndef PIXELCONTEXT_H
+#define PIXELCONTEXT_H
+
+#include <vector>
+
+/* -----------------------------------------------------------------------------------------------
+
+pixel context
+
+ state of the pixel being rendered, passed from one feature pass to the next (position on the
+ sphere and in the maps, surface properties, light). each thread of the pixel loop owns one
+ context, while the renderer with its frame parameters is shared read-only by all threads.
+
+ the wave statistics of a thread are added to the renderer after the pixel loop, as well as the
+ glow of city lights under clouds, which spills into the pixels left and above of a light and
+ therefore gets applied once all pixels are rendered.
+
+----------------------------------------------------------------------------------------------- */
+
+// cloud glow of a city light: neighbor pixel color = color * shadow + light
+struct CloudGlow {
+  int index;      // in image buffer, of the light
+  float shadow;
+  float light[3];
+};
+
+struct PixelContext {
+  // image pixel
+  int img_i,img_j;
+  int index;      // in image buffer
+
+  // position in image plane, z on hemisphere (range [-1,1])
+  float px,py,pz;
+  float px_org,py_org;
+  float pHeight;
+
+  // position on rotated globe
+  double px_rot,py_rot,pz_rot;
+  double p_azimuth,p_elevation;
+  double pyDepth;
+
+  // position in surface map, original wave map position for image enhancement
+  int tx,ty;
+  int tx_w,ty_w,idx_w;
+
+  // surface
+  bool water;
+  float albedo;
+  float surfaceMap_gray_intensity;
+  float cloud_intensity;
+  double lightanglefactor;
+
+  bool linemecontour;
+
+  // wave statistics
+  double maxScale;
+  float waves_val_min;
+  float waves_val_max;
+
+  // city lights under clouds
+  std::vector<CloudGlow> glows;
+
+  PixelContext() {
+    img_i = img_j = 0;
+    index = 0;
+    px = py = pz = 0.0f;
+    px_org = py_org = 0.0f;
+    pHeight = 0.0f;
+    px_rot = py_rot = pz_rot = 0.0;
+    p_azimuth = p_elevation = 0.0;
+    pyDepth = 0.0;
+    tx = ty = 0;
+    tx_w = ty_w = idx_w = 0;
+    water = false;
+    albedo = 1.0f;
+    surfaceMap_gray_intensity = 1.0f;
+    cloud_intensity = 0.0f;
+    lightanglefactor = 0.0;
+    linemecontour = false;
+    maxScale = 0.0;
+    waves_val_min = 1.e10;
+    waves_val_max = -1.e10;
+  }
+};
+
+#endif  // PIXELCONTEXT_H
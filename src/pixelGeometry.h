@@ -0,0 +1,153 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// pixelGeometry.h
+#ifndef PIXELGEOMETRY_H
+#define PIXELGEOMETRY_H
+
+#include <vector>
+
+/* -----------------------------------------------------------------------------------------------
+
+pixel geometry cache
+
+ azimuth, elevation and texel index of each pixel on the sphere, for views that stay the same
+ over frames. the first frame of a view records them while rendering, the frames after take
+ them instead of the trigonometry of each pixel. the view is given by image center lat/lon,
+ sphere radius and center and image size; another view invalidates the cache.
+
+ arrays hold the pixels of each row between its first and last pixel on the sphere.
+
+----------------------------------------------------------------------------------------------- */
+
+#define GEOMETRY_OFF    0
+#define GEOMETRY_RECORD 1
+#define GEOMETRY_REPLAY 2
+
+class PixelGeometry {
+public:
+  PixelGeometry();
+  ~PixelGeometry();
+
+  bool matches(double latitude, double longitude, int radius, int cx, int cy, int width, int height) const;
+  bool init(double latitude, double longitude, int radius, int cx, int cy, int width, int height,
+            const std::vector<int> &first, const std::vector<int> &last);
+  void release();
+
+  // array index of pixel (i,j) on the sphere
+  int index(int i, int j) const { return rowoffset[j] + i - rowfirst[j]; }
+
+  // number of pixels in arrays
+  int size() const { return npixels; }
+
+  int mode;
+
+  double *azimuth;
+  double *elevation;
+  int    *texel;      // index ty*width+tx in surface map
+
+private:
+  // view
+  double latitude;
+  double longitude;
+  int radius;
+  int cx;
+  int cy;
+  int width;
+  int height;
+
+  int npixels;
+  std::vector<int> rowfirst;
+  std::vector<int> rowoffset;
+
+  // not copyable (owns its arrays)
+  PixelGeometry(const PixelGeometry&);
+  PixelGeometry& operator=(const PixelGeometry&);
+};
+
+PixelGeometry::PixelGeometry() {
+  mode = GEOMETRY_OFF;
+  azimuth = NULL;
+  elevation = NULL;
+  texel = NULL;
+  latitude = 0.0;
+  longitude = 0.0;
+  radius = 0;
+  cx = 0;
+  cy = 0;
+  width = 0;
+  height = 0;
+  npixels = 0;
+}
+
+PixelGeometry::~PixelGeometry() {
+  release();
+}
+
+bool PixelGeometry::matches(double lat, double lon, int r, int x, int y, int w, int h) const {
+  return azimuth != NULL && lat == latitude && lon == longitude && r == radius &&
+         x == cx && y == cy && w == width && h == height;
+}
+
+// allocates arrays for the rows' spans first..last of pixels on the sphere (first > last for none)
+
+bool PixelGeometry::init(double lat, double lon, int r, int x, int y, int w, int h,
+                         const std::vector<int> &first, const std::vector<int> &last) {
+  TRACE("pixelGeometry: init")
+
+  release();
+
+  rowfirst = first;
+  rowoffset.resize(h);
+  npixels = 0;
+  for (int j=0; j<h; j++) {
+    rowoffset[j] = npixels;
+    if (last[j] >= first[j]) npixels += last[j] - first[j] + 1;
+  }
+
+  azimuth   = (double *)malloc(std::max(npixels,1)*sizeof(double));
+  elevation = (double *)malloc(std::max(npixels,1)*sizeof(double));
+  texel     = (int *)malloc(std::max(npixels,1)*sizeof(int));
+  if (azimuth == NULL || elevation == NULL || texel == NULL) {
+    std::cerr << "Warning: could not allocate pixel geometry cache, continuing without" << std::endl;
+    release();
+    return false;
+  }
+
+  latitude = lat;
+  longitude = lon;
+  radius = r;
+  cx = x;
+  cy = y;
+  width = w;
+  height = h;
+  return true;
+}
+
+void PixelGeometry::release() {
+  if (azimuth != NULL) free(azimuth);
+  if (elevation != NULL) free(elevation);
+  if (texel != NULL) free(texel);
+  azimuth = NULL;
+  elevation = NULL;
+  texel = NULL;
+  rowfirst.clear();
+  rowoffset.clear();
+  npixels = 0;
+  mode = GEOMETRY_OFF;
+}
+
+#endif  // PIXELGEOMETRY_H
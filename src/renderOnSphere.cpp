@@ -778,93 +778,158 @@ int RenderOnSphere::getInput(int nargs, char **args, bool usage=false){
     if (strequals(args[i],"-nosplatting") || usage) {
       if (usage) std::cerr << "  -nosplatting              turn off wave splatting" << std::endl;
       else{
-        extrapasses = 0;
+        splatter.extrapasses = 0;
         found = true;
       }
     }
     if (strequals(args[i],"-splatpasses") || usage) {
       if (usage) std::cerr << "  -splatpasses val          use (val) passes for wave splatting" << std::endl;
       else{
-        sscanf(args[++i],"%i",&extrapasses);
+        sscanf(args[++i],"%i",&splatter.extrapasses);
         found = true;
       }
     }
     if (strequals(args[i],"-nolinefill") || usage) {
       if (usage) std::cerr << "  -nolinefill               turn off line filling sweep" << std::endl;
       else{
-        doholefillingsweep = 0;
+        splatter.holefillingsweeps = 0;
         found = true;
       }
     }
     if (strequals(args[i],"-linefill") || usage) {
       if (usage) std::cerr << "  -linefill                 turn on line filling sweep" << std::endl;
       else{
-        doholefillingsweep = 2;
+        splatter.holefillingsweeps = 2;
         found = true;
       }
     }
     if (strequals(args[i],"-wavesmapsize") || usage) {
       if (usage) std::cerr << "  -wavesmapsize w h         wavefield map size width,height" << std::endl;
       else{
-        sscanf(args[++i],"%i",&wavesOnMapWidth);
-        sscanf(args[++i],"%i",&wavesOnMapHeight);
+        sscanf(args[++i],"%i",&splatter.wavesOnMapWidth);
+        sscanf(args[++i],"%i",&splatter.wavesOnMapHeight);
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-wavesmapcube") || usage) {
+      if (usage) std::cerr << "  -wavesmapcube n           cubed sphere wavefield map with faces n x n (0 == map width/4)" << std::endl;
+      else{
+        splatter.cubedsphere = true;
+        sscanf(args[++i],"%i",&splatter.cubefacesize);
         found = true;
       }
     }
     if (strequals(args[i],"-wavesmapheight") || usage) {
       if (usage) std::cerr << "  -wavesmapheight h         wavefield map height" << std::endl;
       else{
-        sscanf(args[++i],"%i",&wavesOnMapHeight);
+        sscanf(args[++i],"%i",&splatter.wavesOnMapHeight);
         found = true;
       }
     }
     if (strequals(args[i],"-wavesmapwidth") || usage) {
       if (usage) std::cerr << "  -wavesmapwidth w          wavefield map width" << std::endl;
       else{
-        sscanf(args[++i],"%i",&wavesOnMapWidth);
+        sscanf(args[++i],"%i",&splatter.wavesOnMapWidth);
         found = true;
       }
     }
     if (strequals(args[i],"-ncoords") || usage) {
       if (usage) std::cerr << "  -ncoords val              number of coordinate points" << std::endl;
       else{
-        sscanf(args[++i],"%i",&ncoords);
+        sscanf(args[++i],"%i",&splatter.ncoords);
         found = true;
       }
     }
     if (strequals(args[i],"-usebounds") || usage) {
       if (usage) std::cerr << "  -usebounds min max        use bounds min,max on wavefield values" << std::endl;
       else{
-        usesetbounds = true;
-        sscanf(args[++i],"%lf",&minvalbound);
-        sscanf(args[++i],"%lf",&maxvalbound);
+        splatter.usesetbounds = true;
+        sscanf(args[++i],"%lf",&splatter.minvalbound);
+        sscanf(args[++i],"%lf",&splatter.maxvalbound);
         found = true;
       }
     }
     if (strequals(args[i],"-coordsfile") || usage) {
       if (usage) std::cerr << "  -coordsfile file          coordinate points filename" << std::endl;
       else{
-        coordsfile = args[++i];
+        splatter.coordsfile = args[++i];
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-datacontainer") || usage) {
+      if (usage) std::cerr << "  -datacontainer file       wavefield container file (coordinates and frames, from genDataFromBin -o)" << std::endl;
+      else{
+        splatter.datacontainer = args[++i];
         found = true;
       }
     }
     if (strequals(args[i],"-splatkernel") || usage) {
       if (usage) std::cerr << "  -splatkernel radius       turn on wave kernel splatting with radius size" << std::endl;
       else{
-        splatkernel = true;
+        splatter.splatkernel = true;
         int kernelRadius;
         sscanf(args[++i],"%i",&kernelRadius);
-        kernelRadiusX = kernelRadiusY = kernelRadius;
+        splatter.kernelRadiusX = splatter.kernelRadiusY = kernelRadius;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-splatoperator") || usage) {
+      if (usage) std::cerr << "  -splatoperator            splat frames as sparse matrix product (operator derived once)" << std::endl;
+      else{
+        splatter.splatoperator = true;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-splatoperatorcache") || usage) {
+      if (usage) std::cerr << "  -splatoperatorcache       same as -splatoperator, caches operator in file next to coordsfile" << std::endl;
+      else{
+        splatter.splatoperator = true;
+        splatter.splatoperatorcache = true;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-connectivity") || usage) {
+      if (usage) std::cerr << "  -connectivity file        rasterize element quads (4 int point indices each) instead of splatting" << std::endl;
+      else{
+        splatter.connectivityfile = args[++i];
         found = true;
       }
     }
     if (strequals(args[i],"-masknoise") || usage) {
       if (usage) std::cerr << "  -masknoise cutoff startframe endframe       mask noise between start,end frame numbers" << std::endl;
       else{
-        docutoff = true;
-        sscanf(args[++i],"%lf",&cutoff);
-        sscanf(args[++i],"%i", &startcutoffframe);
-        sscanf(args[++i],"%i", &endcutoffframe);
+        splatter.docutoff = true;
+        sscanf(args[++i],"%lf",&splatter.cutoff);
+        sscanf(args[++i],"%i", &splatter.startcutoffframe);
+        sscanf(args[++i],"%i", &splatter.endcutoffframe);
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-noactivetiles") || usage) {
+      if (usage) std::cerr << "  -noactivetiles            turn off skipping of inactive wavefield regions" << std::endl;
+      else{
+        splatter.activetiles = false;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-activethreshold") || usage) {
+      if (usage) std::cerr << "  -activethreshold val      skip wavefield regions below val times the frame maximum (default 0)" << std::endl;
+      else{
+        sscanf(args[++i],"%lf",&splatter.activethreshold);
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-outputbuffers") || usage) {
+      if (usage) std::cerr << "  -outputbuffers n          image buffers for writing frames while rendering (default 2, 1 writes in order)" << std::endl;
+      else{
+        sscanf(args[++i],"%i",&outputbuffers);
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-noprefetch") || usage) {
+      if (usage) std::cerr << "  -noprefetch               turn off reading ahead next wavefield frame while rendering" << std::endl;
+      else{
+        use_prefetch = false;
         found = true;
       }
     }
@@ -903,6 +968,41 @@ int RenderOnSphere::getInput(int nargs, char **args, bool usage=false){
         found = true;
       }
     }
+    if (strequals(args[i],"-renderframes") || usage) {
+      if (usage) std::cerr << "  -renderframes list        only render frames in list, e.g. 100,300-500 (numbering as with all frames)" << std::endl;
+      else{
+        if (! parseRenderFrames(args[++i])){
+          std::cerr << "Error. invalid frame list for -renderframes: " << args[i] << ". Exiting." << std::endl;
+          return 1;
+        }
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-workers") || usage) {
+      if (usage) std::cerr << "  -workers n                render frames with n worker processes (frames taken in turn)" << std::endl;
+      else{
+        sscanf(args[++i],"%i",&workers);
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-queue") || usage) {
+      if (usage) std::cerr << "  -queue dir                take frames from queue in (shared) spool directory dir" << std::endl;
+      else{
+        queuedir = args[++i];
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-queuetimeout") || usage) {
+      if (usage) std::cerr << "  -queuetimeout val         seconds without heartbeat until queued frames get taken over (default 600)" << std::endl;
+      else{
+        sscanf(args[++i],"%lf",&queuetimeout);
+        if (! (queuetimeout > 0.0)){
+          std::cerr << "Error. queue timeout must be positive. Exiting." << std::endl;
+          return 1;
+        }
+        found = true;
+      }
+    }
     if (strequals(args[i],"-interlace") || usage) {
       if (usage) std::cerr << "  -interlace nframes        turn on interlacing with number of frames (nframes)" << std::endl;
       else{
@@ -948,7 +1048,15 @@ int RenderOnSphere::getInput(int nargs, char **args, bool usage=false){
     if (strequals(args[i],"-datafiletemplate") || usage) {
       if (usage) std::cerr << "  -datafiletemplate file    data template filename" << std::endl;
       else{
-        datafiletemplate=args[++i];
+        splatter.datafiletemplate=args[++i];
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-datafileindex") || usage) {
+      if (usage) std::cerr << "  -datafileindex offset step   data file number (frame+offset)*step (e.g. for bin_movie_%06i.d.gz)" << std::endl;
+      else{
+        sscanf(args[++i],"%i",&splatter.datafileoffset);
+        sscanf(args[++i],"%i",&splatter.datafilestep);
         found = true;
       }
     }
@@ -979,6 +1087,39 @@ int RenderOnSphere::getInput(int nargs, char **args, bool usage=false){
         found = true;
       }
     }
+    if (strequals(args[i],"-nogeometrycache") || usage) {
+      if (usage) std::cerr << "  -nogeometrycache          turn off caching pixel positions on the globe of non-rotating views" << std::endl;
+      else{
+        use_geometrycache = false;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-nobaselayer") || usage) {
+      if (usage) std::cerr << "  -nobaselayer              turn off caching the globe below the wavefield of non-rotating views" << std::endl;
+      else{
+        use_baselayer = false;
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-tilesize") || usage) {
+      if (usage) std::cerr << "  -tilesize n               size of image tiles rendered by each OpenMP thread (default 64)" << std::endl;
+      else{
+        tilesize = atoi(args[++i]);
+        if (tilesize < 1){
+          std::cerr << "Error. tile size must be at least 1. Exiting." << std::endl;
+          return 1;
+        }
+        found = true;
+      }
+    }
+    if (strequals(args[i],"-timing") || usage) {
+      if (usage) std::cerr << "  -timing file              write per-stage timing of each frame to file (CSV, or JSON for *.json)" << std::endl;
+      else{
+        timing.filename = args[++i];
+        timing.enabled = true;
+        found = true;
+      }
+    }
 
 
     if (usage){
@@ -1156,6 +1297,21 @@ int RenderOnSphere::printInfo(){
     std::cerr << "  interlace nframes : " << interlace_nframes << std::endl;
   }
 
+  // frame selection
+  frametasks.clear();
+  for (int frame=frame_first; frame<=frame_last; frame+=frame_step){
+    if (rendersFrame(frame)) frametasks.push_back(frame);
+  }
+  if (! renderframes.empty()){
+    int nselected = (int)frametasks.size();
+    int num_frames = (frame_last - frame_first) / frame_step + 1;
+    if (nselected == 0){
+      std::cerr << "Error. no frames of -renderframes within frame range " << frame_first << " - " << frame_last << ". Exiting." << std::endl;
+      return 1;
+    }
+    std::cerr << "render frames: " << nselected << " of " << num_frames << std::endl;
+  }
+
   std::cerr << "Start lat/lon: " << latitude << " / " << longitude << std::endl;
 
   if (addTime){
@@ -1308,35 +1464,37 @@ int RenderOnSphere::createImagebuffer(){
   //if (image_w > 1000) boldfactor = 2; // makes time text bigger, let user decide...
   //if (image_w > 2000) boldfactor = 4;
 
-  // full image picture
-  imagebuffer = (unsigned char*)calloc(image_h*image_w*3,1);
-  if (imagebuffer == NULL) {
-    std::cerr << "Error. could not allocate image buffer. Exiting." << std::endl;
-    return 1;
-  }
-
   // small image picture
   halfWidth  = image_w/2;
   halfHeight = image_h/2;
 
-  if (create_halfimage){
-    halfimagebuffer = (unsigned char*)malloc(halfHeight*halfWidth*3);
-    if (halfimagebuffer == NULL) {
-      std::cerr << "Error. could not allocate half image buffer. Exiting." << std::endl;
-      return 1;
-    }
-  }
+  // ring of full and half image pictures, written by the output stage
+  size_t halfsize = 0;
+  if (create_halfimage) halfsize = halfHeight*halfWidth*3;
+
+  if (! imagering.init(outputbuffers,image_h*image_w*3,halfsize)) return 1;
   return 0;
 }
 
 
-void RenderOnSphere::setupSplatter(int nargs, char **args){
+// starts output stage of image ring (after forking workers, threads do not carry over fork)
+
+void RenderOnSphere::startImageOutput(){
+  TRACE("renderOnSphere::startImageOutput")
+
+  imagering.start([this](FrameImage &frame){ return outputFrame(frame); });
+
+  if (imagering.size() > 1 && verbose) std::cerr << "image output: " << imagering.size() << " buffers, written by output thread" << std::endl;
+}
+
+
+int RenderOnSphere::setupSplatter(int nargs, char **args){
   TRACE("renderOnSphere::setupSplatter")
 
   std::cerr << "Splatter: " << std::endl;
 
   // will read in additional setting (frames and splatter)
-  initSplatter(verbose);
+  if (! splatter.init(verbose)) return 1;
 
   std::cerr << std::endl;
   std::cerr << "First frame: " << frame_first << std::endl;
@@ -1344,9 +1502,9 @@ void RenderOnSphere::setupSplatter(int nargs, char **args){
   std::cerr << " frame step: " << frame_step << std::endl;
   std::cerr << std::endl;
   if (use_wavefield){
-    std::cerr << "splat kernels: " << splatkernel << std::endl;
-    if (splatkernel){
-      std::cerr << "kernel radius: " << kernelRadiusX << " " << kernelRadiusY << std::endl << std::endl;
+    std::cerr << "splat kernels: " << splatter.splatkernel << std::endl;
+    if (splatter.splatkernel){
+      std::cerr << "kernel radius: " << splatter.kernelRadiusX << " " << splatter.kernelRadiusY << std::endl << std::endl;
     }
   }
   std::cerr << "verbose      : " << verbose << std::endl << std::endl;
@@ -1379,17 +1537,27 @@ void RenderOnSphere::setupSplatter(int nargs, char **args){
 
 
   // allocates wave arrays
-  initSplatter_waves(waves,wavesc,wavesd);
+  splatter.initWaves(waves,wavesc,wavest,wavesd);
 
   // interlaced second wavefield
   if (interlaced_waves){
     // initializes second wavefield, but uses the same wavesd distances
-    initSplatter_waves(interwaves,interwavesc,wavesd);
+    splatter.initWaves(interwaves,interwavesc,interwavest,wavesd);
+  }
+
+  // prefetch wavefield
+  if (use_wavefield && use_prefetch){
+    if (! prefetch.init(splatter)) use_prefetch = false;
   }
 
   // initializes rendering
   longitudeStart = longitude;
   latitudeStart  = latitude;
+  sunStart[0] = sun[0];
+  sunStart[1] = sun[1];
+  sunStart[2] = sun[2];
+
+  return 0;
 }
 
 
@@ -1690,6 +1858,35 @@ void RenderOnSphere::setupFrame(){
     determineCityDistances(latitude,longitude,ncities,cities,cityDistances,cityDistancesPixel,globe_radius_km);
   }
 
+  // view rotation (see setupPixelOnSphere)
+  //
+  // converts lat/lon to azimuth/elevation
+  // + 180 - 90 = + 90 (quarter rotation into center of screen)
+  //
+  //double lat = (double)(-latitude      )/180.0*pi;
+  //double lon = (double)( longitude+90.0)/180.0*pi;
+  //
+  //// double t1 = cos(lon);
+  //// double t3 = sin(lon);
+  //// double t6 = cos(lat);
+  //// double t8 = sin(lat);
+  //
+  double lat = latitude * pi/180.0;
+  double lon = longitude * pi/180.0;
+  rotatelatlon_2_center(&lat, &lon);
+
+  t1 = cos(lon);
+  t3 = sin(lon);
+  t5 = sin(lat);
+  t8 = cos(lat);
+
+  // pixel positions and globe below wavefield of static view
+  setupGeometry();
+  setupBaseLayer();
+
+  // pixels on sphere and backglow
+  setupSpans();
+
   /* -----------------------------------------------------------------------------------------------
 
     // reads wave field
@@ -1704,43 +1901,49 @@ void RenderOnSphere::setupFrame(){
         // uses 2 wavefields
         // one at current time and one at one step ahead of time
         if (nframe == frame_first){
-          readAndSplatWaves(nframe,waves,wavesc,wavesd,verbose);
+          readWaves(nframe,waves,wavesc,wavest);
           // reads in ahead of time to interpolate interlaced wavefield
-          if (nframe <= (frame_last-frame_step)) readAndSplatWaves(nframe+frame_step,interwaves,interwavesc,wavesd,verbose);
+          if (nframe <= (frame_last-frame_step)) readWaves(nframe+frame_step,interwaves,interwavesc,interwavest);
         }else{
           // switch pointers
           // interlace wavefield becomes new current wavefield
           float *tmp = waves;
           short *tmpc = wavesc;
+          unsigned char *tmpt = wavest;
           waves = interwaves;
           wavesc = interwavesc;
+          wavest = interwavest;
           interwaves = tmp;
           interwavesc = tmpc;
+          interwavest = tmpt;
           // reads in ahead of time to interpolate interlaced wavefield
           if (nframe <= (frame_last-frame_step)){
-            readAndSplatWaves(nframe+frame_step,interwaves,interwavesc,wavesd,verbose);
+            readWaves(nframe+frame_step,interwaves,interwavesc,interwavest);
           }else{
             // copy last time step again
-            memcpy(interwaves, waves, wavesOnMapSize*sizeof(float));;
-            memcpy(interwavesc, wavesc, wavesOnMapSize*sizeof(short));;
+            memcpy(interwaves, waves, splatter.wavesOnMapSize*sizeof(float));;
+            memcpy(interwavesc, wavesc, splatter.wavesOnMapSize*sizeof(short));;
+            memcpy(interwavest, wavest, splatter.ntilesx*splatter.ntilesy*sizeof(unsigned char));
           }
         }
       }else{
         // just reads current wavefield
-        readAndSplatWaves(nframe,waves,wavesc,wavesd,verbose);
+        readWaves(nframe,waves,wavesc,wavest);
       }
     }
   }
 
   // waves min/max actual values from reading in original wavefield
-  waves_min = minval;
-  waves_max = maxval;
+  // (waves_min, waves_max are set by readAndSplatWaves)
+
+  // inactive wave map tiles can be skipped in addWaves for the current bounds and colors
+  if (use_wavefield) skipinactivewaves = splatter.activetiles && zeroWavesUnchanged();
 
   /*
   // gets min/max of splatted wave
   float waves_min = 1.e10;
   float waves_max = -1.e10;
-  for (int i=0; i < wavesOnMapSize; i++){
+  for (int i=0; i < splatter.wavesOnMapSize; i++){
     if (waves[i] < waves_min) waves_min = waves[i];
     if (waves[i] > waves_max) waves_max = waves[i];
   }
@@ -1750,6 +1953,272 @@ void RenderOnSphere::setupFrame(){
 
 }
 
+// records pixel positions on the globe with the first frame of a view that does not rotate,
+// later frames of the same view take them from the cache
+
+void RenderOnSphere::setupGeometry(){
+  TRACE("renderOnSphere::setupGeometry")
+
+  if (! use_geometrycache || rotateglobe){
+    geometry.mode = GEOMETRY_OFF;
+    return;
+  }
+
+  // recorded by previous frame
+  if (geometry.matches(latitude,longitude,radius,center.x,center.y,image_w,image_h)){
+    if (geometry.mode == GEOMETRY_RECORD && verbose) std::cerr << "  pixel geometry cached" << std::endl;
+    geometry.mode = GEOMETRY_REPLAY;
+    return;
+  }
+
+  // spans of pixels on sphere in each row
+  std::vector<int> first(image_h);
+  std::vector<int> last(image_h);
+  for (int j=0; j<image_h; j++){
+    rowSpan(j,false,first[j],last[j]);
+  }
+
+  if (geometry.init(latitude,longitude,radius,center.x,center.y,image_w,image_h,first,last)){
+    geometry.mode = GEOMETRY_RECORD;
+  }
+}
+
+// records the globe below the wavefield with the first frame of a view where globe and sun do not rotate,
+// later frames start from it
+//
+// note: the wavefield distorts the surface with -enhanced, elevation distorts geometry and light
+//       such that these are rendered for each frame. city positions are determined by the recording
+//       frame and stay the same for the frames after.
+
+void RenderOnSphere::setupBaseLayer(){
+  TRACE("renderOnSphere::setupBaseLayer")
+
+  if (! use_baselayer || geometry.mode == GEOMETRY_OFF || rotatesun || use_image_enhancement || use_elevation){
+    baselayer.release();
+    return;
+  }
+
+  // recorded by previous frame of same view
+  if (geometry.mode == GEOMETRY_REPLAY && baselayer.mode != BASELAYER_OFF){
+    baselayer.mode = BASELAYER_REPLAY;
+    return;
+  }
+
+  if (baselayer.init(geometry.size())) baselayer.mode = BASELAYER_RECORD;
+}
+
+// determines for each row the pixels on sphere and backglow, the pixels outside only show background,
+// and splits the image into render tiles
+
+void RenderOnSphere::setupSpans(){
+  TRACE("renderOnSphere::setupSpans")
+
+  spanfirst.resize(image_h);
+  spanlast.resize(image_h);
+  for (int j=0; j<image_h; j++){
+    rowSpan(j,backglow,spanfirst[j],spanlast[j]);
+  }
+
+  // pixels on sphere (for tile cost)
+  std::vector<int> spherefirst(spanfirst);
+  std::vector<int> spherelast(spanlast);
+  if (backglow){
+    for (int j=0; j<image_h; j++){
+      rowSpan(j,false,spherefirst[j],spherelast[j]);
+    }
+  }
+
+  // most expensive tiles first when running several threads
+  bool sorted = false;
+#if defined(_OPENMP)
+  sorted = (omp_get_max_threads() > 1);
+#endif
+  tiles.setup(image_w,image_h,tilesize,spanfirst,spanlast,spherefirst,spherelast,sorted);
+}
+
+// reads and splats wavefield frame into given wave map,
+// takes it from the prefetch if it has been read ahead and starts reading ahead the frame after
+
+void RenderOnSphere::readWaves(int frame, float* &wv, short* &wvc, unsigned char* &wvt){
+  TRACE("renderOnSphere::readWaves")
+
+  SplatTiming splattiming;
+  if (! use_prefetch || ! prefetch.take(frame,wv,wvc,wvt,waves_min,waves_max,&splattiming)){
+    splatter.readAndSplatWaves(frame,wv,wvc,wvt,wavesd,wavedata,waves_min,waves_max,verbose,&splattiming);
+  }
+  timing.addSplat(splattiming,frame_number,nframe);
+
+  // next claimed frame gets read and splatted while this one renders
+  if (use_prefetch && nextframe <= frame_last && nextframe != frame) prefetch.start(nextframe,wavesd,verbose);
+}
+
+
+// parses -renderframes list of frame numbers and ranges first-last, separated by commas
+
+bool RenderOnSphere::parseRenderFrames(const char *list){
+  const char *p = list;
+  while (*p != '\0'){
+    int first,last,n;
+    if (sscanf(p,"%d%n",&first,&n) != 1) return false;
+    p += n;
+    last = first;
+    if (*p == '-'){
+      p++;
+      if (sscanf(p,"%d%n",&last,&n) != 1) return false;
+      p += n;
+    }
+    if (last < first) return false;
+    renderframes.push_back(first);
+    renderframes.push_back(last);
+    if (*p == ',') p++;
+    else if (*p != '\0') return false;
+  }
+  return ! renderframes.empty();
+}
+
+// checks if frame gets rendered (all frames without -renderframes)
+
+bool RenderOnSphere::rendersFrame(int frame){
+  if (renderframes.empty()) return true;
+  for (size_t n=0; n<renderframes.size(); n+=2){
+    if (frame >= renderframes[n] && frame <= renderframes[n+1]) return true;
+  }
+  return false;
+}
+
+// sets up frame queue in spool directory
+//
+// note: the job gets identified by all render parameters, except for the ones that do not change images
+
+int RenderOnSphere::setupQueue(int nargs, char **args){
+  TRACE("renderOnSphere::setupQueue")
+
+  if (queuedir == NULL) return 0;
+
+  std::string params;
+  for (int i=1; i<nargs; i++){
+    if (strequals(args[i],"-queue") || strequals(args[i],"-queuetimeout") || strequals(args[i],"-workers") ||
+        strequals(args[i],"-renderframes") || strequals(args[i],"-outputbuffers") ||
+        strequals(args[i],"-timing") || strequals(args[i],"-tilesize")){ i++; continue; }
+    if (strequals(args[i],"-verbose") || strequals(args[i],"-noprefetch") ||
+        strequals(args[i],"-nogeometrycache") || strequals(args[i],"-nobaselayer")) continue;
+    if (params.length() > 0) params += " ";
+    params += args[i];
+  }
+
+  if (! framequeue.init(queuedir,params,queuetimeout)) return 1;
+  return 0;
+}
+
+
+// claims next frame to render (beyond frame_last if none left)
+//
+// with wait, waits for frames taken by other processes in the queue (see FrameQueue::claim)
+//
+// note: with -workers, the worker processes claim frames from a counter in shared memory,
+//       thus faster workers take more frames.
+
+int RenderOnSphere::claimFrame(bool wait){
+  // frames from spool directory
+  if (framequeue.active()) return framequeue.claim(frametasks,frame_last + frame_step,wait,verbose);
+
+  int task;
+  if (framecounter != NULL){
+    task = __sync_fetch_and_add(&framecounter[0],1);
+  }else{
+    task = frametask++;
+  }
+  if (task >= (int)frametasks.size()) return frame_last + frame_step;
+  return frametasks[task];
+}
+
+
+// forks worker processes, which return to render frames (worker >= 0),
+// while this process waits for them to finish
+//
+// note: maps, wave map setup and city tables are shared with the workers (copy-on-write)
+
+int RenderOnSphere::forkWorkers(){
+  TRACE("renderOnSphere::forkWorkers")
+
+  // shared counters: claimed frames, rendered frames
+  framecounter = (int *)mmap(NULL,2*sizeof(int),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+  if (framecounter == MAP_FAILED){
+    framecounter = NULL;
+    std::cerr << "Error. could not map shared frame counter. Exiting." << std::endl;
+    return 1;
+  }
+  framecounter[0] = 0;
+  framecounter[1] = 0;
+
+  std::cerr << "frame farm: " << workers << " worker processes, " << frametasks.size() << " frames" << std::endl;
+
+  struct timeval t0;
+  gettimeofday(&t0, NULL);
+
+  // flushes output, otherwise buffered output gets written again by each worker
+  std::cerr.flush();
+  std::cout.flush();
+  fflush(NULL);
+
+  std::vector<pid_t> pids;
+  for (int w=0; w<workers; w++){
+    pid_t pid = fork();
+    if (pid < 0){
+      std::cerr << "Error. could not fork worker " << w << ". Exiting." << std::endl;
+      break;
+    }
+    if (pid == 0){
+      worker = w;
+#if defined(_OPENMP)
+      // the OpenMP thread pool of this process does not carry over fork,
+      // each worker renders with a single thread
+      omp_set_num_threads(1);
+#endif
+      return 0;
+    }
+    pids.push_back(pid);
+  }
+
+  // waits for workers
+  int failed = (int)(workers - pids.size());
+  for (size_t n=0; n<pids.size(); n++){
+    int status;
+    if (waitpid(pids[n],&status,0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0){
+      std::cerr << "Error. worker " << n << " failed." << std::endl;
+      failed++;
+    }
+  }
+
+  struct timeval t1;
+  gettimeofday(&t1, NULL);
+  double time_taken = (double) (t1.tv_usec - t0.tv_usec) / 1000000 + (double) (t1.tv_sec - t0.tv_sec);
+
+  int nrendered = framecounter[1];
+  std::cerr << std::endl;
+  std::cerr << "frame farm: " << nrendered << " frames rendered by " << workers << " workers in " << time_taken << " sec";
+  if (time_taken > 0.0) std::cerr << " (" << nrendered/time_taken << " frames/s)";
+  std::cerr << std::endl << std::endl;
+
+  munmap(framecounter,2*sizeof(int));
+  framecounter = NULL;
+
+  // (with -queue, other processes render frames as well)
+  if (failed > 0 || (! framequeue.active() && nrendered < (int)frametasks.size())){
+    std::cerr << "Error. " << (int)frametasks.size() - nrendered << " frames not rendered. Exiting." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+
+// counts rendered frame (for frame farm statistics)
+
+void RenderOnSphere::frameDone(){
+  if (framecounter != NULL) __sync_fetch_and_add(&framecounter[1],1);
+}
+
+
 void RenderOnSphere::printInterlaceInfo(){
   TRACE("renderOnSphere::printInterlaceInfo")
   if (interlaced && verbose){
@@ -1766,7 +2235,9 @@ void RenderOnSphere::printFrameInfo(){
 
   // user info
   std::cerr << std::endl;
-  std::cerr << "* Rendering frame " << nframe << "/" << frame_last << std::endl;
+  std::cerr << "* Rendering frame " << nframe << "/" << frame_last;
+  if (worker >= 0) std::cerr << " (worker " << worker << ")";
+  std::cerr << std::endl;
 
   if (addTime){
     int currentTime = (int)(stepTime * (double)nframe + startTime);
@@ -1776,6 +2247,13 @@ void RenderOnSphere::printFrameInfo(){
   }
 }
 
+// adds wave statistics of a pixel loop thread
+
+void RenderOnSphere::addWaveStats(const PixelContext &p){
+  if (p.maxScale > maxScale) maxScale = p.maxScale;
+  if (p.waves_val_min < waves_val_min) waves_val_min = p.waves_val_min;
+  if (p.waves_val_max > waves_val_max) waves_val_max = p.waves_val_max;
+}
 
 void RenderOnSphere::printWaveStats(){
   TRACE("renderOnSphere::printWaveStats")
@@ -1790,17 +2268,32 @@ void RenderOnSphere::printWaveStats(){
   }
 }
 
-void RenderOnSphere::determinePixel(int i, int j){
+// writes timing report (worker processes append their worker index to the file name) and summary
+
+int RenderOnSphere::writeTiming(){
+  TRACE("renderOnSphere::writeTiming")
+
+  if (! timing.enabled) return 0;
+
+  std::string filename = timing.filename;
+  if (worker >= 0) filename += "." + std::to_string(worker);
+
+  timing.printSummary();
+  if (! timing.write(filename.c_str())) return 1;
+  std::cerr << "timing report: " << filename << std::endl;
+  return 0;
+}
+
+void RenderOnSphere::determinePixel(PixelContext &p, int i, int j) const{
   TRACE("renderOnSphere::determinePixel")
 
   // array index
-  img_i = i;
-  img_j = j;
-  index = (img_i + img_j*image_w)*3;
+  p.img_i = i;
+  p.img_j = j;
+  p.index = (p.img_i + p.img_j*image_w)*3;
 
   // calculates pixel position with respect to center of sphere (range [0.,1.]
-  px = ((float)img_i-(float)center.x)/(float)radius;
-  py = (((float)image_h-(float)img_j)-(float)center.y)/(float)radius;
+  pixelPosition(p.img_i,p.img_j,p.px,p.py);
 
   /*
   // dummy value
@@ -1814,35 +2307,35 @@ void RenderOnSphere::determinePixel(int i, int j){
   }
   */
 
-  pz = px*px+py*py;
+  p.pz = p.px*p.px+p.py*p.py;
 
   // backup values for backglow (px,py,pz will change depending on map distortions)
-  px_org = px;
-  py_org = py;
+  p.px_org = p.px;
+  p.py_org = p.py;
 
-  pHeight = 0.0f;
+  p.pHeight = 0.0f;
 
   // background
-  imagebuffer[index  ] = background_color[0];
-  imagebuffer[index+1] = background_color[1];
-  imagebuffer[index+2] = background_color[2];
+  imagebuffer[p.index  ] = background_color[0];
+  imagebuffer[p.index+1] = background_color[1];
+  imagebuffer[p.index+2] = background_color[2];
 
   // initilizes pixel flag
-  water = false;
+  p.water = false;
 }
 
 
-bool RenderOnSphere::pixelIsOnSphere(){
+bool RenderOnSphere::pixelIsOnSphere(const PixelContext &p) const{
   TRACE("renderOnSphere::pixelIsOnSphere")
 
   // pixel location [px,py,pz]
   bool is_on_sphere = false;
-  if (py>=-1.0f && py<=1.0f) {
+  if (p.py>=-1.0f && p.py<=1.0f) {
     // pixel location within bounding box of sphere - y-direction == height
-    if (px>=-1.0f && px<=1.0f) {
+    if (p.px>=-1.0f && p.px<=1.0f) {
       // pixel location within bounding box of sphere - x-direction == width
       // checks with radius
-      if (pz <= 1.0f) {
+      if (p.pz <= 1.0f) {
         is_on_sphere = true;
       }
     }
@@ -1850,20 +2343,86 @@ bool RenderOnSphere::pixelIsOnSphere(){
   return is_on_sphere;
 }
 
+// checks if pixel (i,j) is on sphere or, with backglow, within backglow (same tests as pixelIsOnSphere and addBackglow)
 
+bool RenderOnSphere::pixelInSpan(int i, int j, bool with_backglow) const{
+  float x,y;
+  pixelPosition(i,j,x,y);
+  float z = x*x + y*y;
+  if (y>=-1.0f && y<=1.0f && x>=-1.0f && x<=1.0f && z <= 1.0f) return true;
+  if (with_backglow && z >= 1.0 && z <= backglow_falloff) return true;
+  return false;
+}
 
-void RenderOnSphere::setupPixelOnSphere(){
+// first and last pixel of row j on sphere (and backglow), first > last for none
+//
+// note: distance to sphere center grows monotonically with |i - center.x|, thus pixels inside form
+//       a single span around the center column. the span estimated from the circle only serves as
+//       starting point, its ends are moved with the exact pixel test.
+
+void RenderOnSphere::rowSpan(int j, bool with_backglow, int &first, int &last) const{
+  // none (left part of row covers all)
+  first = image_w;
+  last = image_w-1;
+
+  // closest pixel to center in this row
+  int ic = std::min(std::max(center.x,0),image_w-1);
+  if (! pixelInSpan(ic,j,with_backglow)) return;
+
+  // circle radius in pixels
+  float x,y;
+  pixelPosition(ic,j,x,y);
+  double r2 = 1.0;
+  if (with_backglow && backglow_falloff > r2) r2 = backglow_falloff;
+  double halfwidth = sqrt(std::max(r2 - (double)y*(double)y,0.0)) * radius;
+
+  first = std::min(std::max((int)floor(center.x - halfwidth),0),ic);
+  while (first > 0 && pixelInSpan(first-1,j,with_backglow)) first--;
+  while (first < ic && ! pixelInSpan(first,j,with_backglow)) first++;
+
+  last = std::max(std::min((int)ceil(center.x + halfwidth),image_w-1),ic);
+  while (last < image_w-1 && pixelInSpan(last+1,j,with_backglow)) last++;
+  while (last > ic && ! pixelInSpan(last,j,with_backglow)) last--;
+}
+
+// fills pixels first..last of row j with background color
+
+void RenderOnSphere::fillBackground(int j, int first, int last) const{
+  if (last < first) return;
+
+  unsigned char *row = imagebuffer + (first + j*image_w)*3;
+  int n = last - first + 1;
+
+  if (background_color[0] == background_color[1] && background_color[0] == background_color[2]){
+    memset(row,background_color[0],n*3);
+  }else{
+    // first pixel, then doubles copied pattern
+    row[0] = background_color[0];
+    row[1] = background_color[1];
+    row[2] = background_color[2];
+    int done = 3;
+    while (done < n*3){
+      int len = std::min(done,n*3-done);
+      memcpy(row+done,row,len);
+      done += len;
+    }
+  }
+}
+
+
+
+void RenderOnSphere::setupPixelOnSphere(PixelContext &p) const{
   TRACE("renderOnSphere::setupPixel")
 
   // converts flat x/y position to x/y/z position on a hemisphere
   // z-coordinate for point on hemisphere
-  pz = (float)sqrt(1.0-pz); // in range [0.,1.], height = 0 at the sphere rim, height = 1 at center of sphere
-  pHeight = pz;
+  p.pz = (float)sqrt(1.0-p.pz); // in range [0.,1.], height = 0 at the sphere rim, height = 1 at center of sphere
+  p.pHeight = p.pz;
 
   if (fakeposcolor) {
-    imagebuffer[index  ]=(unsigned char)(px*122.5+122.5);
-    imagebuffer[index+1]=(unsigned char)(py*122.5+122.5);
-    imagebuffer[index+2]=(unsigned char)(pz*122.5+122.5);
+    imagebuffer[p.index  ]=(unsigned char)(p.px*122.5+122.5);
+    imagebuffer[p.index+1]=(unsigned char)(p.py*122.5+122.5);
+    imagebuffer[p.index+2]=(unsigned char)(p.pz*122.5+122.5);
   }
 
   /* -----------------------------------------------------------------------------------------------
@@ -1871,78 +2430,96 @@ void RenderOnSphere::setupPixelOnSphere(){
   // sets positions in rotated frame
 
   ----------------------------------------------------------------------------------------------- */
-  // converts lat/lon to azimuth/elevation
-  // + 180 - 90 = + 90 (quarter rotation into center of screen)
-  //
-  //double lat = (double)(-latitude      )/180.0*pi;
-  //double lon = (double)( longitude+90.0)/180.0*pi;
-  //
-  //// double t1 = cos(lon);
-  //// double t3 = sin(lon);
-  //// double t6 = cos(lat);
-  //// double t8 = sin(lat);
-  //
-  double lat = latitude * pi/180.0;
-  double lon = longitude * pi/180.0;
-  rotatelatlon_2_center(&lat, &lon);
-
-  t1 = cos(lon);
-  t3 = sin(lon);
-  t5 = sin(lat);
-  t8 = cos(lat);
+  // view rotation t1,t3,t5,t8 is set for the frame in setupFrame
 
   // [px py pz]
   // rotated position
   //double px_rot = px*t1+pz*t3;
   //double py_rot = py*t6-t8*px*t3+t8*pz*t1;
   //double pz_rot = -py*t8-t6*px*t3+t6*pz*t1;
-  px_rot = (double)(px*t1 - t3*py*t5 + t3*pz*t8);   //px*cos(lon) - py*sin(lon)*sin(lat) + pz*sin(lon)*cos(lat)
-  py_rot = (double)(py*t8 + pz*t5);                 //              py*cos(lat)          + pz*sin(lat)
-  pz_rot = (double)(-px*t3 - t1*py*t5 + t1*pz*t8);  //-px*sin(lon) -py*cos(lon)*sin(lat) + pz*cos(lon)*cos(lat)
-
-  // current point position in (azimuth,elevation)
-  // ranges: elevation between [-pi/2,pi/2]
-  //         azimuth between [-pi/2,3/2pi] // rotated to have lat/lon=(0/0) in center
-  xyz_2_azimuthelevation(px_rot,py_rot,pz_rot,&p_azimuth,&p_elevation);
-
-  // bounds lat [-pi/2,pi/2]
-  if (p_elevation < -pi/2.0) p_elevation = -pi/2.0f;
-  if (p_elevation > pi/2.0) p_elevation = pi/2.0f;
-  // bounds lon [-pi,pi]
-  if (p_azimuth < -pi) p_azimuth += 2.0*pi;
-  if (p_azimuth > pi) p_azimuth -= 2.0*pi;
+  p.px_rot = (double)(p.px*t1 - t3*p.py*t5 + t3*p.pz*t8);   //px*cos(lon) - py*sin(lon)*sin(lat) + pz*sin(lon)*cos(lat)
+  p.py_rot = (double)(p.py*t8 + p.pz*t5);                 //              py*cos(lat)          + pz*sin(lat)
+  p.pz_rot = (double)(-p.px*t3 - t1*p.py*t5 + t1*p.pz*t8);  //-px*sin(lon) -py*cos(lon)*sin(lat) + pz*cos(lon)*cos(lat)
+
+  if (geometry.mode == GEOMETRY_REPLAY){
+    // position of static view
+    int g = geometry.index(p.img_i,p.img_j);
+    p.p_azimuth = geometry.azimuth[g];
+    p.p_elevation = geometry.elevation[g];
+  } else {
+    // current point position in (azimuth,elevation)
+    // ranges: elevation between [-pi/2,pi/2]
+    //         azimuth between [-pi/2,3/2pi] // rotated to have lat/lon=(0/0) in center
+    xyz_2_azimuthelevation(p.px_rot,p.py_rot,p.pz_rot,&p.p_azimuth,&p.p_elevation);
+
+    // bounds lat [-pi/2,pi/2]
+    if (p.p_elevation < -pi/2.0) p.p_elevation = -pi/2.0f;
+    if (p.p_elevation > pi/2.0) p.p_elevation = pi/2.0f;
+    // bounds lon [-pi,pi]
+    if (p.p_azimuth < -pi) p.p_azimuth += 2.0*pi;
+    if (p.p_azimuth > pi) p.p_azimuth -= 2.0*pi;
+
+    if (geometry.mode == GEOMETRY_RECORD){
+      int g = geometry.index(p.img_i,p.img_j);
+      geometry.azimuth[g] = p.p_azimuth;
+      geometry.elevation[g] = p.p_elevation;
+    }
+  }
 
   // depth
-  pyDepth = (double) sqrt(1.0-py_rot*py_rot);
+  p.pyDepth = (double) sqrt(1.0-p.py_rot*p.py_rot);
 
   //if (i%100 == 0 && j%10 == 0)
   //  std::cerr << "point: azimuth = " << p_azimuth*180./pi << " elevation = " << p_elevation*180./pi << " depth = " << pyDepth << std::endl;
 
   // initializes
-  tx = 0;
-  ty = 0;
+  p.tx = 0;
+  p.ty = 0;
 
   // for use_image_enhancement
-  tx_w = 0;
-  ty_w = 0;
-  idx_w = 0;
+  p.tx_w = 0;
+  p.ty_w = 0;
+  p.idx_w = 0;
+
+  p.linemecontour = false;
+}
+
+// adds busy time since t of this thread on a render tile
 
-  linemecontour = false;
+void RenderOnSphere::pixelBusy(double t) const{
+  if (timing.enabled) timing.addBusy(timingClock()-t);
 }
 
+// adds time since t to pixel pass stage (on this thread), returns current time
 
-void RenderOnSphere::addSurface(){
+double RenderOnSphere::pixelLap(int stage, double t) const{
+  if (! timing.enabled) return t;
+
+  double now = timingClock();
+  timing.addThread(stage,now-t);
+  return now;
+}
+
+
+void RenderOnSphere::addSurface(PixelContext &p) const{
   TRACE("renderOnSphere::addSurface")
 
   // adds surface texture
   if (surfaceMap != NULL) {
-    if (pyDepth != 0.0f) {
+    if (p.pyDepth != 0.0f) {
 
       //cities original place was here...
       // moved it down as we possibly change the p_azimuth,p_elevation slightly in the following options
 
       // pixel position in earth map
-      getpixelposition(p_azimuth,p_elevation,surfaceMapWidth,surfaceMapHeight,&tx,&ty);
+      if (geometry.mode == GEOMETRY_REPLAY){
+        int t = geometry.texel[geometry.index(p.img_i,p.img_j)];
+        p.tx = t % surfaceMapWidth;
+        p.ty = t / surfaceMapWidth;
+      } else {
+        getpixelposition(p.p_azimuth,p.p_elevation,surfaceMapWidth,surfaceMapHeight,&p.tx,&p.ty);
+        if (geometry.mode == GEOMETRY_RECORD) geometry.texel[geometry.index(p.img_i,p.img_j)] = p.ty*surfaceMapWidth + p.tx;
+      }
 
       // elevation based on gray image in range [0,1]
       if (use_elevation && topoMap != NULL){
@@ -1954,7 +2531,7 @@ void RenderOnSphere::addSurface(){
         float sum = 0.0f;
         for (int jj=0; jj<avg_box; jj++){
           for (int ii=0; ii<avg_box; ii++){
-            int mapidx = (ty+jj-(avg_box-1)/2)*surfaceMapWidth + (tx+ii-(avg_box-1)/2);
+            int mapidx = (p.ty+jj-(avg_box-1)/2)*surfaceMapWidth + (p.tx+ii-(avg_box-1)/2);
             if (mapidx < 0) mapidx = 0;
             if (mapidx >= surfaceMapWidth*surfaceMapHeight) mapidx = surfaceMapWidth*surfaceMapHeight-1;
             // gray color
@@ -1978,22 +2555,22 @@ void RenderOnSphere::addSurface(){
         //ele = pow(ele,1.0);
 
         // distorts texture
-        px *= (1.0 - elevation_intensity * ele);
-        py *= (1.0 - elevation_intensity * ele);
+        p.px *= (1.0 - elevation_intensity * ele);
+        p.py *= (1.0 - elevation_intensity * ele);
 
-        pz = px*px + py*py;
-        if (pz > 1.0f) pz = 1.0f;
-        pz = (float) sqrt(1.0-pz);
-        pHeight = pz;
+        p.pz = p.px*p.px + p.py*p.py;
+        if (p.pz > 1.0f) p.pz = 1.0f;
+        p.pz = (float) sqrt(1.0-p.pz);
+        p.pHeight = p.pz;
         // bounds
-        if (px > 1.0f) px = 1.0f;
-        if (px <-1.0f) px =-1.0f;
-        if (py > 1.0f) px = 1.0f;
-        if (py <-1.0f) px =-1.0f;
+        if (p.px > 1.0f) p.px = 1.0f;
+        if (p.px <-1.0f) p.px =-1.0f;
+        if (p.py > 1.0f) p.px = 1.0f;
+        if (p.py <-1.0f) p.px =-1.0f;
 
         // distorts wavefield
-        float px_w = px;
-        float py_w = py;
+        float px_w = p.px;
+        float py_w = p.py;
 
         float pz_w = px_w*px_w + py_w*py_w;
         if (pz_w > 1.0f) pz_w = 1.0f;
@@ -2003,9 +2580,9 @@ void RenderOnSphere::addSurface(){
         if (pz_w > 1.0f) pz_w = 1.0f;
 
         // recalculates position
-        px_rot = px_w*t1 - t3*py_w*t5 + t3*pz_w*t8;
-        py_rot = py_w*t8 + pz_w*t5;
-        pz_rot = -px_w*t3 - t1*py_w*t5 + t1*pz_w*t8;
+        p.px_rot = px_w*t1 - t3*py_w*t5 + t3*pz_w*t8;
+        p.py_rot = py_w*t8 + pz_w*t5;
+        p.pz_rot = -px_w*t3 - t1*py_w*t5 + t1*pz_w*t8;
 
         // checks
         //if( py_rot < -1.0f ){std::cerr << "py_rot:" << py_rot << std::endl;return false;}
@@ -2014,29 +2591,29 @@ void RenderOnSphere::addSurface(){
         // asin( -1 to 1) -> -PI/2 and PI/2
 
         // bounds
-        if (px_rot < -1.0f) px_rot = -1.0f;
-        if (px_rot > 1.0f) px_rot = 1.0f;
+        if (p.px_rot < -1.0f) p.px_rot = -1.0f;
+        if (p.px_rot > 1.0f) p.px_rot = 1.0f;
 
-        if (py_rot < -1.0f) py_rot = -1.0f;
-        if (py_rot > 1.0f) py_rot = 1.0f;
+        if (p.py_rot < -1.0f) p.py_rot = -1.0f;
+        if (p.py_rot > 1.0f) p.py_rot = 1.0f;
 
-        if (pz_rot < -1.0f) pz_rot = -1.0f;
-        if (pz_rot > 1.0f) pz_rot = 1.0f;
+        if (p.pz_rot < -1.0f) p.pz_rot = -1.0f;
+        if (p.pz_rot > 1.0f) p.pz_rot = 1.0f;
 
         // updates positions
         // azimuth/elevation update
-        xyz_2_azimuthelevation(px_rot,py_rot,pz_rot,&p_azimuth,&p_elevation);
+        xyz_2_azimuthelevation(p.px_rot,p.py_rot,p.pz_rot,&p.p_azimuth,&p.p_elevation);
         // bounds lat [-pi/2,pi/2]
-        if (p_elevation < -pi/2.0) p_elevation = -pi/2.0f;
-        if (p_elevation > pi/2.0) p_elevation = pi/2.0f;
+        if (p.p_elevation < -pi/2.0) p.p_elevation = -pi/2.0f;
+        if (p.p_elevation > pi/2.0) p.p_elevation = pi/2.0f;
         // bounds lon [-pi,pi]
-        if (p_azimuth < -pi) p_azimuth += 2.0*pi;
-        if (p_azimuth > pi) p_azimuth -= 2.0*pi;
+        if (p.p_azimuth < -pi) p.p_azimuth += 2.0*pi;
+        if (p.p_azimuth > pi) p.p_azimuth -= 2.0*pi;
 
         // depth update
-        pyDepth = sqrt(1.0f-py_rot*py_rot);
+        p.pyDepth = sqrt(1.0f-p.py_rot*p.py_rot);
         // pixel position in earth map update
-        getpixelposition(p_azimuth,p_elevation,surfaceMapWidth,surfaceMapHeight,&tx,&ty);
+        getpixelposition(p.p_azimuth,p.p_elevation,surfaceMapWidth,surfaceMapHeight,&p.tx,&p.ty);
       }
 
 
@@ -2052,16 +2629,19 @@ void RenderOnSphere::addSurface(){
         float factor_enhance = 0.01;
 
         // takes wavefield amplitudes
-        tx_w = tx;
-        ty_w = ty;
+        p.tx_w = p.tx;
+        p.ty_w = p.ty;
 
-        tx_w /= textureMapToWavesMapFactor;
-        ty_w /= textureMapToWavesMapFactor;
-        tx_w = wavesOnMapWidth-tx_w-1;
-        ty_w = wavesOnMapHeight-ty_w-1;
+        p.tx_w /= textureMapToWavesMapFactor;
+        p.ty_w /= textureMapToWavesMapFactor;
+        p.tx_w = splatter.wavesOnMapWidth-p.tx_w-1;
+        p.ty_w = splatter.wavesOnMapHeight-p.ty_w-1;
 
         // original wavefield index
-        idx_w = tx_w+ty_w*wavesOnMapWidth;
+        if (splatter.cubedsphere)
+          p.idx_w = splatter.cubeMapIndex(p.px_rot,p.py_rot,p.pz_rot);
+        else
+          p.idx_w = p.tx_w+p.ty_w*splatter.wavesOnMapWidth;
 
         // check
         //if( idx_w < 0 ){std::cerr << "idx_w: " << idx_w << std::endl; return false;}
@@ -2070,9 +2650,9 @@ void RenderOnSphere::addSurface(){
         // scales value between -1 and 1
         float d;
         // normalizes to range [-1,1]
-        if (wavesc[idx_w] != 0){
-          d = waves[idx_w]/(float)wavesc[idx_w];
-          if (usesetbounds){
+        if (wavesc[p.idx_w] != 0){
+          d = waves[p.idx_w]/(float)wavesc[p.idx_w];
+          if (splatter.usesetbounds){
             // uses range set by -usebounds options
             if (d < waves_min){ d = waves_min;}
             if (d > waves_max){ d = waves_max;}
@@ -2091,9 +2671,9 @@ void RenderOnSphere::addSurface(){
         // note: this pixel interpolation will lead to flickering, should be improved...
         if (interlaced_waves){
           float d2;
-          if (interwavesc[idx_w] != 0){
-            d2 = interwaves[idx_w]/(float)interwavesc[idx_w];
-            if (usesetbounds){
+          if (interwavesc[p.idx_w] != 0){
+            d2 = interwaves[p.idx_w]/(float)interwavesc[p.idx_w];
+            if (splatter.usesetbounds){
               // uses range set by -usebounds options
               if (d2 < waves_min){ d2 = waves_min;}
               if (d2 > waves_max){ d2 = waves_max;}
@@ -2118,13 +2698,13 @@ void RenderOnSphere::addSurface(){
 
         // should draw contours, but this doesn't look nice, too simple...
         if (drawContour){
-          if( fabs(d - 0.25f ) <= 0.01f ) linemecontour=true;
-          if( fabs(d - 0.5f ) <= 0.01f ) linemecontour=true;
-          if( fabs(d - 0.75f ) <= 0.01f ) linemecontour=true;
+          if( fabs(d - 0.25f ) <= 0.01f ) p.linemecontour=true;
+          if( fabs(d - 0.5f ) <= 0.01f ) p.linemecontour=true;
+          if( fabs(d - 0.75f ) <= 0.01f ) p.linemecontour=true;
           //if( fabs(d - 1.0f ) <= 0.01f ) linemecontour=true;
-          if( fabs(d + 0.25f ) <= 0.01f ) linemecontour=true;
-          if( fabs(d + 0.5f ) <= 0.01f ) linemecontour=true;
-          if( fabs(d + 0.75f ) <= 0.01f ) linemecontour=true;
+          if( fabs(d + 0.25f ) <= 0.01f ) p.linemecontour=true;
+          if( fabs(d + 0.5f ) <= 0.01f ) p.linemecontour=true;
+          if( fabs(d + 0.75f ) <= 0.01f ) p.linemecontour=true;
           //if( fabs(d + 1.0f ) <= 0.01f ) linemecontour=true;
         }
 
@@ -2132,7 +2712,7 @@ void RenderOnSphere::addSurface(){
         d = d * factor_enhance;
 
         // for lightning effect
-        pz = pz + DISTORTION_LIGHT * d;
+        p.pz = p.pz + DISTORTION_LIGHT * d;
 
         //px = px + DISTORTION_LIGHT * d;
         //py = py + DISTORTION_LIGHT * d;
@@ -2142,13 +2722,13 @@ void RenderOnSphere::addSurface(){
         //pz = (float) sqrt (1.0-pz);
 
         // bounds for pz
-        if (pz < 0.0f) pz = 0.0f;
-        if (pz > 1.0f) pz = 1.0f;
+        if (p.pz < 0.0f) p.pz = 0.0f;
+        if (p.pz > 1.0f) p.pz = 1.0f;
 
         // adds wavefield displacement
         // distorts earth map
-        float px_w = px + DISTORTION_MAP * d;
-        float py_w = py + DISTORTION_MAP * d;
+        float px_w = p.px + DISTORTION_MAP * d;
+        float py_w = p.py + DISTORTION_MAP * d;
         float pz_w = px_w*px_w + py_w*py_w;
 
         //float px_w = px;
@@ -2159,9 +2739,9 @@ void RenderOnSphere::addSurface(){
         pz_w = (float) sqrt (1.0-pz_w);
 
         // recalculates position
-        px_rot = px_w*t1 - t3*py_w*t5 + t3*pz_w*t8;
-        py_rot = py_w*t8 + pz_w*t5;
-        pz_rot = -px_w*t3 - t1*py_w*t5 + t1*pz_w*t8;
+        p.px_rot = px_w*t1 - t3*py_w*t5 + t3*pz_w*t8;
+        p.py_rot = py_w*t8 + pz_w*t5;
+        p.pz_rot = -px_w*t3 - t1*py_w*t5 + t1*pz_w*t8;
 
         // checks
         //if( py_rot < -1.0f ){std::cerr << "py_rot:" << py_rot << std::endl;return false;}
@@ -2170,27 +2750,27 @@ void RenderOnSphere::addSurface(){
         // asin( -1 to 1) -> -PI/2 and PI/2
 
         // bounds
-        if (px_rot < -1.0f) px_rot = -1.0f;
-        if (px_rot > 1.0f) px_rot = 1.0f;
-        if (py_rot < -1.0f) py_rot = -1.0f;
-        if (py_rot > 1.0f) py_rot = 1.0f;
-        if (pz_rot < -1.0f) pz_rot = -1.0f;
-        if (pz_rot > 1.0f) pz_rot = 1.0f;
+        if (p.px_rot < -1.0f) p.px_rot = -1.0f;
+        if (p.px_rot > 1.0f) p.px_rot = 1.0f;
+        if (p.py_rot < -1.0f) p.py_rot = -1.0f;
+        if (p.py_rot > 1.0f) p.py_rot = 1.0f;
+        if (p.pz_rot < -1.0f) p.pz_rot = -1.0f;
+        if (p.pz_rot > 1.0f) p.pz_rot = 1.0f;
 
         // updates positions
         // azimuth/elevation update
-        xyz_2_azimuthelevation(px_rot,py_rot,pz_rot,&p_azimuth,&p_elevation);
+        xyz_2_azimuthelevation(p.px_rot,p.py_rot,p.pz_rot,&p.p_azimuth,&p.p_elevation);
         // bounds lat [-pi/2,pi/2]
-        if (p_elevation < -pi/2.0) p_elevation = -pi/2.0f;
-        if (p_elevation > pi/2.0) p_elevation = pi/2.0f;
+        if (p.p_elevation < -pi/2.0) p.p_elevation = -pi/2.0f;
+        if (p.p_elevation > pi/2.0) p.p_elevation = pi/2.0f;
         // bounds lon [-pi,pi]
-        if (p_azimuth < -pi) p_azimuth += 2.0*pi;
-        if (p_azimuth > pi) p_azimuth -= 2.0*pi;
+        if (p.p_azimuth < -pi) p.p_azimuth += 2.0*pi;
+        if (p.p_azimuth > pi) p.p_azimuth -= 2.0*pi;
 
         // depth update
-        pyDepth = sqrt(1.0f-py_rot*py_rot);
+        p.pyDepth = sqrt(1.0f-p.py_rot*p.py_rot);
         // pixel position in earth map update
-        getpixelposition(p_azimuth,p_elevation,surfaceMapWidth,surfaceMapHeight,&tx,&ty);
+        getpixelposition(p.p_azimuth,p.p_elevation,surfaceMapWidth,surfaceMapHeight,&p.tx,&p.ty);
 
         //if(verbose) std::cerr << "pyDepth:" << pyDepth << std::endl;
       } //use_image_enhancement
@@ -2200,17 +2780,17 @@ void RenderOnSphere::addSurface(){
       // updates pixel distances
       if (renderCityNames){
         determineCityPosition(ncities,cityDistances,cityDistancesPixel,cityAzi,cityEle,
-                              cityPositionX,cityPositionY,img_i,img_j,p_azimuth,p_elevation);
+                              cityPositionX,cityPositionY,p.img_i,p.img_j,p.p_azimuth,p.p_elevation);
       }
 
     } else {
       // pyDepth == 0.0
-      if (p_elevation>=0.0) {
-        tx = 0;
-        ty = 0;
+      if (p.p_elevation>=0.0) {
+        p.tx = 0;
+        p.ty = 0;
       } else {
-        tx = 0;
-        ty = surfaceMapHeight-1;
+        p.tx = 0;
+        p.ty = surfaceMapHeight-1;
       }
     }
 
@@ -2233,15 +2813,15 @@ void RenderOnSphere::addSurface(){
       surfaceMap_gray_intensity = sum / float(avg_box*avg_box); // average pixel color
       */
       // single value
-      int mapidx = (ty*surfaceMapWidth + tx)*3;
-      surfaceMap_gray_intensity = (float)(surfaceMap[mapidx] + surfaceMap[mapidx+1] + surfaceMap[mapidx+2])/3.0f;
+      int mapidx = (p.ty*surfaceMapWidth + p.tx)*3;
+      p.surfaceMap_gray_intensity = (float)(surfaceMap[mapidx] + surfaceMap[mapidx+1] + surfaceMap[mapidx+2])/3.0f;
 
       // normalizes
-      surfaceMap_gray_intensity /= 255.0f;
+      p.surfaceMap_gray_intensity /= 255.0f;
 
       // intensity in range [0,1]
-      if (surfaceMap_gray_intensity > 1.0f) surfaceMap_gray_intensity = 1.0f;
-      if (surfaceMap_gray_intensity < 0.0f) surfaceMap_gray_intensity = 0.0f;
+      if (p.surfaceMap_gray_intensity > 1.0f) p.surfaceMap_gray_intensity = 1.0f;
+      if (p.surfaceMap_gray_intensity < 0.0f) p.surfaceMap_gray_intensity = 0.0f;
 
       //std::cerr << "gray intensity: " << surfaceMap_gray_intensity << " " << avg_box << std::endl;
     }
@@ -2251,72 +2831,72 @@ void RenderOnSphere::addSurface(){
       TRACE("renderOnSphere: use graymap")
       // gray earth
       //imagebuffer[index] = imagebuffer[index+1] = imagebuffer[index+2] = (int)((surfaceMap[t] + surfaceMap[t+1] + surfaceMap[t+2])/3.0);
-      imagebuffer[index] = imagebuffer[index+1] = imagebuffer[index+2] = (int)(surfaceMap_gray_intensity*255.0);
+      imagebuffer[p.index] = imagebuffer[p.index+1] = imagebuffer[p.index+2] = (int)(p.surfaceMap_gray_intensity*255.0);
     } else {
-      int t = (ty*surfaceMapWidth+tx)*3;
+      int t = (p.ty*surfaceMapWidth+p.tx)*3;
       // true color
-      imagebuffer[index  ] = surfaceMap[t+2];
-      imagebuffer[index+1] = surfaceMap[t+1];
-      imagebuffer[index+2] = surfaceMap[t  ];
+      imagebuffer[p.index  ] = surfaceMap[t+2];
+      imagebuffer[p.index+1] = surfaceMap[t+1];
+      imagebuffer[p.index+2] = surfaceMap[t  ];
     }
 
     // oceans
     if (use_ocean){
       TRACE("renderOnSphere: use ocean")
-      if (imagebuffer[index  ] == oceancolor[0] &&
-          imagebuffer[index+1] == oceancolor[1] &&
-          imagebuffer[index+2] == oceancolor[2]) {
+      if (imagebuffer[p.index  ] == oceancolor[0] &&
+          imagebuffer[p.index+1] == oceancolor[1] &&
+          imagebuffer[p.index+2] == oceancolor[2]) {
         int jitter = (int)drand48()*8;
         //imagebuffer[index  ]=111+jitter;
         //imagebuffer[index+1]=142+jitter;
         //imagebuffer[index+2]=207+jitter;
         int color;
-        color = imagebuffer[index  ]+jitter;
+        color = imagebuffer[p.index  ]+jitter;
         if (color > 255) color = 255;
-        imagebuffer[index  ] = color;
-        color = imagebuffer[index+1]+jitter;
+        imagebuffer[p.index  ] = color;
+        color = imagebuffer[p.index+1]+jitter;
         if (color > 255) color = 255;
-        imagebuffer[index+1] = color;
-        color = imagebuffer[index+2]+jitter;
+        imagebuffer[p.index+1] = color;
+        color = imagebuffer[p.index+2]+jitter;
         if (color > 255) color = 255;
-        imagebuffer[index+2] = color;
-        water = true;
+        imagebuffer[p.index+2] = color;
+        p.water = true;
       }
     }
   } else {
     // no earth map
-    imagebuffer[index  ] = background_color[0];
-    imagebuffer[index+1] = background_color[1];
-    imagebuffer[index+2] = background_color[2];
+    imagebuffer[p.index  ] = background_color[0];
+    imagebuffer[p.index+1] = background_color[1];
+    imagebuffer[p.index+2] = background_color[2];
   }
 }
 
 
-void RenderOnSphere::addLines(){
+void RenderOnSphere::addLines(const PixelContext &p) const{
   TRACE("renderOnSphere::addLines")
 
   // lines
   if (drawlines) {
     TRACE("renderOnSphere: draw lines")
     bool lineme = false;
-    if ((int)(2.0*p_azimuth/pi*180.0)%(int)(2.0*degreesbetweenlines)==0) lineme = true;
-    else if ((int)(2.0*p_elevation/pi*180.0)%(int)(2.0*degreesbetweenlines)==0) lineme = true;
+    if ((int)(2.0*p.p_azimuth/pi*180.0)%(int)(2.0*degreesbetweenlines)==0) lineme = true;
+    else if ((int)(2.0*p.p_elevation/pi*180.0)%(int)(2.0*degreesbetweenlines)==0) lineme = true;
     //adds missing lines
     if (90%(int)degreesbetweenlines == 0){
-      if (fabs(p_azimuth/pi*180.0 + 90.0) < 0.49) lineme = true;
-      else if (fabs(p_azimuth/pi*180.0 - 90.0) < 0.49) lineme = true;
+      if (fabs(p.p_azimuth/pi*180.0 + 90.0) < 0.49) lineme = true;
+      else if (fabs(p.p_azimuth/pi*180.0 - 90.0) < 0.49) lineme = true;
     }
     //std::cerr << "azimuth: " << p_azimuth/3.14159*180.0 << " " << lineme << std::endl;
     if (lineme) {
-      imagebuffer[index  ] = 150; //imagebuffer[index  ]/2;
-      imagebuffer[index+1] = 150; //imagebuffer[index+1]/2;
-      imagebuffer[index+2] = 150; //imagebuffer[index+2]/2;
+      imagebuffer[p.index  ] = 150; //imagebuffer[index  ]/2;
+      imagebuffer[p.index+1] = 150; //imagebuffer[index+1]/2;
+      imagebuffer[p.index+2] = 150; //imagebuffer[index+2]/2;
     }
   }
 }
 
 
-void RenderOnSphere::addDiffuseLights(){
+void RenderOnSphere::addDiffuseLights(PixelContext &p) const{
   TRACE("renderOnSphere::addDiffuseLights")
 
   // adds effects to diffuse lightning
@@ -2324,15 +2904,15 @@ void RenderOnSphere::addDiffuseLights(){
   float emission_factor = 1.0f;
 
   // light factor
-  lightanglefactor = px*sun[0]+py*sun[1]+pz*sun[2]; // vector dot product
+  p.lightanglefactor = p.px*sun[0]+p.py*sun[1]+p.pz*sun[2]; // vector dot product
 
   if (verbose){
-    if (img_i == image_w/2 && img_j == image_h/2) std::cerr << "lightanglefactor: " << lightanglefactor << std::endl;
+    if (p.img_i == image_w/2 && p.img_j == image_h/2) std::cerr << "lightanglefactor: " << p.lightanglefactor << std::endl;
   }
 
   // makes sure to stay between [-1,1]
-  if (lightanglefactor < -1.0f) lightanglefactor = -1.0f;
-  if (lightanglefactor > 1.0f) lightanglefactor = 1.0f;
+  if (p.lightanglefactor < -1.0f) p.lightanglefactor = -1.0f;
+  if (p.lightanglefactor > 1.0f) p.lightanglefactor = 1.0f;
 
   // diffuse light
   if (use_diffuselight) {
@@ -2340,17 +2920,17 @@ void RenderOnSphere::addDiffuseLights(){
     emission_factor = emission_intensity;
 
     // adds diffuse light
-    if (lightanglefactor >= 0.0) {
+    if (p.lightanglefactor >= 0.0) {
       int color;
-      color = (int)((double)imagebuffer[index  ]*lightanglefactor*diffuselight_intensity*diffuselight_color_3d[0]);
+      color = (int)((double)imagebuffer[p.index  ]*p.lightanglefactor*diffuselight_intensity*diffuselight_color_3d[0]);
       if (color > 255) color = 255;
       //imagebuffer[index  ] = color;
       diffuseRGB[0] = color;
-      color = (int)((double)imagebuffer[index+1]*lightanglefactor*diffuselight_intensity*diffuselight_color_3d[1]);
+      color = (int)((double)imagebuffer[p.index+1]*p.lightanglefactor*diffuselight_intensity*diffuselight_color_3d[1]);
       if (color > 255) color = 255;
       //imagebuffer[index+1] = color;
       diffuseRGB[1] = color;
-      color = (int)((double)imagebuffer[index+2]*lightanglefactor*diffuselight_intensity*diffuselight_color_3d[2]);
+      color = (int)((double)imagebuffer[p.index+2]*p.lightanglefactor*diffuselight_intensity*diffuselight_color_3d[2]);
       if (color > 255) color = 255;
       //imagebuffer[index+2] = color;
       diffuseRGB[2] = color;
@@ -2367,20 +2947,20 @@ void RenderOnSphere::addDiffuseLights(){
   if (use_hillshading && topoMap != NULL){
     addHillshading(imagebuffer,image_w,image_h,diffuseRGB,
                    topoMap,surfaceMapWidth,surfaceMapHeight,
-                   tx,ty,img_i,img_j,index,
-                   p_azimuth,p_elevation,sun,longitude,
+                   p.tx,p.ty,p.img_i,p.img_j,p.index,
+                   p.p_azimuth,p.p_elevation,sun,longitude,
                    hillshade_scalefactor,hillshade_intensity,
-                   lightanglefactor,verbose);
+                   p.lightanglefactor,verbose);
   }
 
   // clouds
   // for albedo
-  cloud_intensity = 0.0f;
+  p.cloud_intensity = 0.0f;
 
   if (cloudMap != NULL){
     TRACE("renderOnSphere: cloud intensity")
     // gray value
-    int t = (ty*surfaceMapWidth+tx)*3;
+    int t = (p.ty*surfaceMapWidth+p.tx)*3;
     float cval = (float)(cloudMap[t] + cloudMap[t+1] + cloudMap[t+2])/3.0f;
 
     //std::cerr << "clouds: " << (int)cloudMap[t] << " " << (int)cloudMap[t+1] << " " << (int)cloudMap[t+2] << std::endl;
@@ -2391,48 +2971,48 @@ void RenderOnSphere::addDiffuseLights(){
     //cval = pow(cval,0.5);
 
     // cloud intensity [0,1] for albedo
-    cloud_intensity = cval;
+    p.cloud_intensity = cval;
   }
 
   // albedo (surface reflection intensity)
-  albedo = 1.0f;
+  p.albedo = 1.0f;
 
   // albedo based on gray image
   if (use_albedo){
     TRACE("renderOnSphere: use albedo")
     // based on gray earth value
-    albedo = surfaceMap_gray_intensity; // in range [0,1]
+    p.albedo = p.surfaceMap_gray_intensity; // in range [0,1]
 
     // in range [0.3,1.0] for intensity 0.7
-    albedo = (1.0 - albedo_intensity) + albedo_intensity*albedo;
+    p.albedo = (1.0 - albedo_intensity) + albedo_intensity*p.albedo;
 
     // water
-    if (water) albedo = 0.8f;
+    if (p.water) p.albedo = 0.8f;
 
     // adding cloud albedo
     if (cloudMap != NULL){
-      albedo += cloud_intensity;
+      p.albedo += p.cloud_intensity;
     }
 
     // in range [0,1]
-    if (albedo > 1.0f) albedo = 1.0f;
-    if (albedo < 0.0f) albedo = 0.0f;
+    if (p.albedo > 1.0f) p.albedo = 1.0f;
+    if (p.albedo < 0.0f) p.albedo = 0.0f;
 
     // debug info
     if (verbose){
-      if (img_i == image_w/2 && img_j == image_h/2) std::cerr << "albedo: " << albedo << std::endl;
+      if (p.img_i == image_w/2 && p.img_j == image_h/2) std::cerr << "albedo: " << p.albedo << std::endl;
     }
 
     int color;
-    color = (int)((double)diffuseRGB[0]*albedo);
+    color = (int)((double)diffuseRGB[0]*p.albedo);
     if (color > 255) color = 255;
     //imagebuffer[index  ] = color;
     diffuseRGB[0] = color;
-    color = (int)((double)diffuseRGB[1]*albedo);
+    color = (int)((double)diffuseRGB[1]*p.albedo);
     if (color > 255) color = 255;
     //imagebuffer[index+1] = color;
     diffuseRGB[1] = color;
-    color = (int)((double)diffuseRGB[2]*albedo);
+    color = (int)((double)diffuseRGB[2]*p.albedo);
     if (color > 255) color = 255;
     //imagebuffer[index+2] = color;
     diffuseRGB[2] = color;
@@ -2440,25 +3020,25 @@ void RenderOnSphere::addDiffuseLights(){
 
   // adds diffuse lighting: emissivity + diffusivity
   int color;
-  color = (int)((double)imagebuffer[index  ]*emission_factor) + diffuseRGB[0];
+  color = (int)((double)imagebuffer[p.index  ]*emission_factor) + diffuseRGB[0];
   if (color > 255) color = 255;
-  imagebuffer[index  ] = color;
-  color = (int)((double)imagebuffer[index+1]*emission_factor) + diffuseRGB[1];
+  imagebuffer[p.index  ] = color;
+  color = (int)((double)imagebuffer[p.index+1]*emission_factor) + diffuseRGB[1];
   if (color > 255) color = 255;
-  imagebuffer[index+1] = color;
-  color = (int)((double)imagebuffer[index+2]*emission_factor) + diffuseRGB[2];
+  imagebuffer[p.index+1] = color;
+  color = (int)((double)imagebuffer[p.index+2]*emission_factor) + diffuseRGB[2];
   if (color > 255) color = 255;
-  imagebuffer[index+2] = color;
+  imagebuffer[p.index+2] = color;
 }
 
 
-void RenderOnSphere::addSpecularLight(){
+void RenderOnSphere::addSpecularLight(const PixelContext &p) const{
   TRACE("renderOnSphere::addSpecularLight")
 
   // specular lightning
-  if (use_specularlight && lightanglefactor > 0.0) {
+  if (use_specularlight && p.lightanglefactor > 0.0) {
     TRACE("renderOnSphere: use specularlight")
-    double specular_power = pow(lightanglefactor,specularlight_power);
+    double specular_power = pow(p.lightanglefactor,specularlight_power);
 
     // gradient from earth map
     float gradient = 1.0f;
@@ -2469,9 +3049,9 @@ void RenderOnSphere::addSpecularLight(){
       float grad_x,grad_y;
       int tmax = (surfaceMapWidth*surfaceMapHeight-1)*3; // avoids being out of bounds
       // x-direction
-      t  = (ty*surfaceMapWidth+tx)*3;
-      t1 = (ty*surfaceMapWidth+tx-1)*3; //pixel left by 1
-      t2 = (ty*surfaceMapWidth+tx-2)*3; //pixel left by 2
+      t  = (p.ty*surfaceMapWidth+p.tx)*3;
+      t1 = (p.ty*surfaceMapWidth+p.tx-1)*3; //pixel left by 1
+      t2 = (p.ty*surfaceMapWidth+p.tx-2)*3; //pixel left by 2
       if (t < 0) t = 0;
       if (t > tmax) t = tmax;
       if (t1 < 0) t1 = 0;
@@ -2484,9 +3064,9 @@ void RenderOnSphere::addSpecularLight(){
       gray2 = (float) (surfaceMap[t2] + surfaceMap[t2+1] + surfaceMap[t2+2])/3.0f; // pixel left by 2
       grad_x = 1.0 + gradient_intensity * (0.5*gray2 - 2.0*gray1 + 1.5*gray); // finite-difference, backward 1st derivative, 2nd order
       // y-direction
-      t  = (ty*surfaceMapWidth+tx)*3;
-      t1 = ((ty+1)*surfaceMapWidth+tx)*3; //pixel down by 1
-      t2 = ((ty+2)*surfaceMapWidth+tx)*3; //pixel down by 2
+      t  = (p.ty*surfaceMapWidth+p.tx)*3;
+      t1 = ((p.ty+1)*surfaceMapWidth+p.tx)*3; //pixel down by 1
+      t2 = ((p.ty+2)*surfaceMapWidth+p.tx)*3; //pixel down by 2
       if (t < 0) t = 0;
       if (t > tmax) t = tmax;
       if (t1 < 0) t1 = 0;
@@ -2505,51 +3085,51 @@ void RenderOnSphere::addSpecularLight(){
       if (gradient < 0.8f) gradient = 0.8f;
     }
 
-    if (water) {
+    if (p.water) {
       TRACE("renderOnSphere: use water")
       // water uses different specular light color
       specular_power = specular_power*specular_power;
       specular_power *= (specularlight_intensity*2);
 
       int color;
-      color = (int)((double)imagebuffer[index  ]+(specularlight_color_ocean_3d[0]*specular_power*255.9999));
+      color = (int)((double)imagebuffer[p.index  ]+(specularlight_color_ocean_3d[0]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index  ] = color;
-      color = (int)((double)imagebuffer[index+1]+(specularlight_color_ocean_3d[1]*specular_power*255.9999));
+      imagebuffer[p.index  ] = color;
+      color = (int)((double)imagebuffer[p.index+1]+(specularlight_color_ocean_3d[1]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index+1] = color;
-      color = (int)((double)imagebuffer[index+2]+(specularlight_color_ocean_3d[2]*specular_power*255.9999));
+      imagebuffer[p.index+1] = color;
+      color = (int)((double)imagebuffer[p.index+2]+(specularlight_color_ocean_3d[2]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index+2] = color;
+      imagebuffer[p.index+2] = color;
     } else {
       TRACE("renderOnSphere: no water")
       // no water
       specular_power *= specularlight_intensity;
-      specular_power *= gradient*albedo;
+      specular_power *= gradient*p.albedo;
 
       int color;
-      color = (int)((double)imagebuffer[index  ]+(specularlight_color_3d[0]*specular_power*255.9999));
+      color = (int)((double)imagebuffer[p.index  ]+(specularlight_color_3d[0]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index  ] = color;
-      color = (int)((double)imagebuffer[index+1]+(specularlight_color_3d[1]*specular_power*255.9999));
+      imagebuffer[p.index  ] = color;
+      color = (int)((double)imagebuffer[p.index+1]+(specularlight_color_3d[1]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index+1] = color;
-      color = (int)((double)imagebuffer[index+2]+(specularlight_color_3d[2]*specular_power*255.9999));
+      imagebuffer[p.index+1] = color;
+      color = (int)((double)imagebuffer[p.index+2]+(specularlight_color_3d[2]*specular_power*255.9999));
       if (color > 255) color = 255;
-      imagebuffer[index+2] = color;
+      imagebuffer[p.index+2] = color;
     }
   }
 }
 
 
-void RenderOnSphere::addNight(){
+void RenderOnSphere::addNight(const PixelContext &p) const{
   TRACE("renderOnSphere::addNight")
 
   // night image
   if (nightMap != NULL){
 
     // blending factor
-    float blendfactor = 1.0f - lightanglefactor;
+    float blendfactor = 1.0f - p.lightanglefactor;
 
     // scales to [0,1]
     if (blendfactor > 1.0f) blendfactor = 1.0f;
@@ -2569,56 +3149,135 @@ void RenderOnSphere::addNight(){
     //std::cerr << "night: " << blendfactor << std::endl;
 
     // map index
-    int t = (ty*surfaceMapWidth+tx)*3;
+    int t = (p.ty*surfaceMapWidth+p.tx)*3;
 
     // blends over image buffer
     int color;
-    color = (int)((float)imagebuffer[index  ]*(1.0f-blendfactor)+blendfactor*nightMap[t]);
+    color = (int)((float)imagebuffer[p.index  ]*(1.0f-blendfactor)+blendfactor*nightMap[t]);
     if (color > 255) color = 255;
-    imagebuffer[index  ] = color;
+    imagebuffer[p.index  ] = color;
 
-    color = (int)((float)imagebuffer[index+1]*(1.0f-blendfactor)+blendfactor*nightMap[t+1]);
+    color = (int)((float)imagebuffer[p.index+1]*(1.0f-blendfactor)+blendfactor*nightMap[t+1]);
     if (color > 255) color = 255;
-    imagebuffer[index+1] = color;
+    imagebuffer[p.index+1] = color;
 
     // decrease blue content, to get mostly a yellow lightning effect
-    color = (int)((float)imagebuffer[index+2]*(1.0f-blendfactor*0.2)+0.2*blendfactor*nightMap[t+2]);
+    color = (int)((float)imagebuffer[p.index+2]*(1.0f-blendfactor*0.2)+0.2*blendfactor*nightMap[t+2]);
     if (color > 255) color = 255;
-    imagebuffer[index+2] = color;
+    imagebuffer[p.index+2] = color;
   }
 }
 
 
 
-int RenderOnSphere::addWaves(){
+// records pixel of globe below wavefield
+
+void RenderOnSphere::storeBaseLayer(const PixelContext &p) const{
+  if (baselayer.mode != BASELAYER_RECORD) return;
+
+  int g = geometry.index(p.img_i,p.img_j);
+  baselayer.rgb[3*g  ] = imagebuffer[p.index  ];
+  baselayer.rgb[3*g+1] = imagebuffer[p.index+1];
+  baselayer.rgb[3*g+2] = imagebuffer[p.index+2];
+  baselayer.water[g] = p.water;
+  baselayer.lightfactor[g] = p.lightanglefactor;
+  baselayer.tx[g] = p.tx;
+  baselayer.ty[g] = p.ty;
+  baselayer.cloud[g] = p.cloud_intensity;
+}
+
+// takes pixel of globe below wavefield from recording frame
+// (instead of surface, lines, lights and night map)
+
+void RenderOnSphere::addBaseLayer(PixelContext &p) const{
+  TRACE("renderOnSphere::addBaseLayer")
+
+  int g = geometry.index(p.img_i,p.img_j);
+  imagebuffer[p.index  ] = baselayer.rgb[3*g  ];
+  imagebuffer[p.index+1] = baselayer.rgb[3*g+1];
+  imagebuffer[p.index+2] = baselayer.rgb[3*g+2];
+  p.water = baselayer.water[g];
+  p.lightanglefactor = baselayer.lightfactor[g];
+  p.tx = baselayer.tx[g];
+  p.ty = baselayer.ty[g];
+  p.cloud_intensity = baselayer.cloud[g];
+}
+
+
+// checks if blending a zero wavefield value leaves pixels unchanged,
+// for splatted zero values as well as for pixels without splat count
+
+bool RenderOnSphere::zeroWavesUnchanged(){
+  TRACE("renderOnSphere::zeroWavesUnchanged")
+
+  // value of splatted zeros, as scaled in addWaves
+  float v0;
+  if (waves_max - waves_min != 0.0){
+    v0 = (0.0f - waves_min)/(waves_max-waves_min)*2.0f-1.0f;
+  }else{
+    v0 = 0.0f - waves_min;
+  }
+  if (use_image_enhancement && fabs(v0) < CUTSNAPS_DISPLAY_COLOR) v0 = 0.0f;
+  if (v0 != 0.0f) return false;
+
+  // additive colors only change pixels for nonzero values
+  if (colorwavemode == COLOR_WAVE_MODE_ADDITIVE) return true;
+
+  // color of zero value, on land and on water
+  for (int n=0; n<2; n++) {
+    float RGB[3] = { 0.0f, 0.0f, 0.0f };
+    float opacity = 0.0f;
+    if (determineWavesPixelColor(0.0f,RGB,&opacity,n == 1,maxColorIntensity) != 0) return false;
+    if (opacity != 0.0f || RGB[0] >= 1.0f || RGB[1] >= 1.0f || RGB[2] >= 1.0f) return false;
+  }
+  return true;
+}
+
+
+int RenderOnSphere::addWaves(PixelContext &p) const{
   TRACE("renderOnSphere::addWaves")
 
   // renders wavefield
   if (use_wavefield && surfaceMap != NULL) {
     TRACE("renderOnSphere: color waves")
-    int tx_org = tx;
-    int ty_org = ty;
+    int tx_org = p.tx;
+    int ty_org = p.ty;
 
     //if (nframe==100) std::cerr << "O  " << tx << "/" << surfaceMapWidth << std::endl;
-    tx /= textureMapToWavesMapFactor;
-    ty /= textureMapToWavesMapFactor;
-    tx = wavesOnMapWidth-tx-1;
-    ty = wavesOnMapHeight-ty-1;
-    int idx = tx+ty*wavesOnMapWidth;
+    p.tx /= textureMapToWavesMapFactor;
+    p.ty /= textureMapToWavesMapFactor;
+    p.tx = splatter.wavesOnMapWidth-p.tx-1;
+    p.ty = splatter.wavesOnMapHeight-p.ty-1;
+    int idx = p.tx+p.ty*splatter.wavesOnMapWidth;
     //if (nframe==100) std::cerr << "o  " << tx << "/" << wavesOnMapWidth << std::endl;
 
+    // cubed sphere wave map is sampled by direction
+    if (splatter.cubedsphere) idx = splatter.cubeMapIndex(p.px_rot,p.py_rot,p.pz_rot);
+
     // takes original (non-distorted) wavefield index
-    if (use_wavefield && use_image_enhancement) idx = idx_w;
+    if (use_wavefield && use_image_enhancement) idx = p.idx_w;
 
     // keeps maximum displacement
     if (addScale){
-      if (fabs(waves[idx]) > maxScale) maxScale = fabs(waves[idx]);
-      // minval,maxval are determined by original wavefield values in readAndSplatWaves
-      if (fabs(minval) > maxScale) maxScale = fabs(minval);
-      if (fabs(maxval) > maxScale) maxScale = fabs(maxval);
+      if (fabs(waves[idx]) > p.maxScale) p.maxScale = fabs(waves[idx]);
+      // waves_min,waves_max are determined by original wavefield values in readAndSplatWaves
+      if (fabs(waves_min) > p.maxScale) p.maxScale = fabs(waves_min);
+      if (fabs(waves_max) > p.maxScale) p.maxScale = fabs(waves_max);
       // sets min/max manually
-      if (usesetbounds){
-        maxScale = MAX(fabs(minval),fabs(maxval));
+      if (splatter.usesetbounds){
+        p.maxScale = MAX(fabs(waves_min),fabs(waves_max));
+      }
+    }
+
+    // skips inactive tiles (zero values)
+    if (skipinactivewaves) {
+      int tile = splatter.waveTile(idx);
+      if (! wavest[tile] && (! interlaced_waves || ! interwavest[tile])) {
+        if (0.0f > p.waves_val_max) p.waves_val_max = 0.0f;
+        if (0.0f < p.waves_val_min) p.waves_val_min = 0.0f;
+        p.tx = tx_org;
+        p.ty = ty_org;
+        return 0;
       }
     }
 
@@ -2667,8 +3326,8 @@ int RenderOnSphere::addWaves(){
 
     // checks if not a number
     if (v != v){
-      std::cerr << "Error color wave. Nan " << v << " " << index << " " << idx << " "
-                << waves[idx] << " " << wavesc[idx] << " " << minval << " " << maxval << std::endl;
+      std::cerr << "Error color wave. Nan " << v << " " << p.index << " " << idx << " "
+                << waves[idx] << " " << wavesc[idx] << " " << waves_min << " " << waves_max << std::endl;
       return 1;
     }
 
@@ -2694,8 +3353,8 @@ int RenderOnSphere::addWaves(){
     if (v > 1.0f) v = 1.0f;
 
     // min/max of v
-    if (v > waves_val_max) waves_val_max = v;
-    if (v < waves_val_min) waves_val_min = v;
+    if (v > p.waves_val_max) p.waves_val_max = v;
+    if (v < p.waves_val_min) p.waves_val_min = v;
 
     // opacity
     float opacity;
@@ -2703,7 +3362,7 @@ int RenderOnSphere::addWaves(){
 
     if (colorwavemode==COLOR_WAVE_MODE_BLEND){
       // opacity
-      if (water && fadewavesonwater) {
+      if (p.water && fadewavesonwater) {
         v /= 2.0f;
         maxvopacity /= 3.0f;
       }
@@ -2713,7 +3372,7 @@ int RenderOnSphere::addWaves(){
     float RGB[3] = { 0.0f, 0.0f, 0.0f };
 
     // determines color value
-    int ret = determineWavesPixelColor(v,RGB,&opacity,water,maxColorIntensity);
+    int ret = determineWavesPixelColor(v,RGB,&opacity,p.water,maxColorIntensity);
     if (ret != 0) return ret;
 
     // limits opacity
@@ -2723,14 +3382,14 @@ int RenderOnSphere::addWaves(){
       // adds colorvalues
       if (v>0) {
         // red channel
-        int color = (int)( (float)imagebuffer[index  ] + RGB[0] );
+        int color = (int)( (float)imagebuffer[p.index  ] + RGB[0] );
         if (color>255) color = 255;
-        imagebuffer[index  ] = color;
+        imagebuffer[p.index  ] = color;
       } else if (v<0) {
         // blue channel
-        int color = (int)( (float)imagebuffer[index+2] + RGB[2] );
+        int color = (int)( (float)imagebuffer[p.index+2] + RGB[2] );
         if (color>255) color = 255;
-        imagebuffer[index+2] = color;
+        imagebuffer[p.index+2] = color;
       }
     } else if (colorwavemode==COLOR_WAVE_MODE_BLEND) {
       // blends with existing colors
@@ -2742,17 +3401,17 @@ int RenderOnSphere::addWaves(){
       // (imagebuffer is unsigned char, can only hold values of 0-255, otherwise it overflows)
       // (uses first mapping to integer to avoid overflow of imagebuffer element, otherwise weird color artefact occur)
       int color;
-      color = (int)((float)imagebuffer[index  ]*(1.0f-opacity)+RGB[0]);
+      color = (int)((float)imagebuffer[p.index  ]*(1.0f-opacity)+RGB[0]);
       if (color > 255) color = 255;
-      imagebuffer[index  ] = color;
+      imagebuffer[p.index  ] = color;
 
-      color = (int)((float)imagebuffer[index+1]*(1.0f-opacity)+RGB[1]);
+      color = (int)((float)imagebuffer[p.index+1]*(1.0f-opacity)+RGB[1]);
       if (color > 255) color = 255;
-      imagebuffer[index+1] = color;
+      imagebuffer[p.index+1] = color;
 
-      color = (int)((float)imagebuffer[index+2]*(1.0f-opacity)+RGB[2]);
+      color = (int)((float)imagebuffer[p.index+2]*(1.0f-opacity)+RGB[2]);
       if (color > 255) color = 255;
-      imagebuffer[index+2] = color;
+      imagebuffer[p.index+2] = color;
 
       /*
       imagebuffer[index  ]=(int)(RGB[0]);
@@ -2762,14 +3421,14 @@ int RenderOnSphere::addWaves(){
       //std::cerr << "imagebuffer " << (int)imagebuffer[index] << " " << (int)imagebuffer[index+1] << " " << (int)imagebuffer[index+2] <<  std::endl;
     } // colorwavemode
 
-    tx = tx_org;
-    ty = ty_org;
+    p.tx = tx_org;
+    p.ty = ty_org;
   } // surfaceMap
   return 0;
 }
 
 
-void RenderOnSphere::addClouds(){
+void RenderOnSphere::addClouds(PixelContext &p) const{
   TRACE("renderOnSphere::addClouds")
 
   // clouds
@@ -2777,11 +3436,11 @@ void RenderOnSphere::addClouds(){
     TRACE("renderOnSphere: adding Clouds")
 
     // cloud intensity [0,1]
-    float cval = cloud_intensity;
+    float cval = p.cloud_intensity;
 
     //cval = pow(cval,0.8);
 
-    float lightfactor = lightanglefactor;
+    float lightfactor = p.lightanglefactor;
     if (lightfactor < 0.2f) lightfactor = 0.2f;
 
     // cloud shadow
@@ -2791,36 +3450,45 @@ void RenderOnSphere::addClouds(){
     if (shadow > 1.0f) shadow = 1.0f;
     if (shadow < 0.0f) shadow = 0.0f;
 
-    float cloud_hillshade_intensity = 0.15f;
-    float cloud_hillshade_scalefactor = 0.2f;
-
-    // calculating slope, considers cloud colors as topography
-    // (adds plastic effect to clouds, giving cumulus shapes more 3D appearance)
-    int NDIM = 3;         // cloudMap has 3 rgb values
-    bool average = true;  // uses a smoother averaged value
-    float slope,aspect,shaded;
-    // workaround: since cloudMap is unsigned char and topoMap is float, converting one to another would be overhead
-    //             instead, for NDIM == 3 we assume unsigned char cloudMap, NDIM == 1 we assume single float topoMap
-    float *dummy = NULL;         // cloud is unsigned char array, float array not needed for NDIM == 3
+    float shaded;
 
-    // slope & aspect
-    get_topo_slope(NDIM,dummy,cloudMap,surfaceMapWidth,surfaceMapHeight,tx,ty,cloud_hillshade_scalefactor,&slope,&aspect,average);
-
-    // shade
-    get_shade(slope,aspect,p_azimuth,p_elevation,sun,longitude,&shaded);
-
-    // bounds
-    if (shaded < 0.0f) shaded = 0.0f;
+    if (useBaseLayer()){
+      // shading of static view
+      shaded = baselayer.cloudshade[geometry.index(p.img_i,p.img_j)];
+    } else {
+      float cloud_hillshade_intensity = 0.15f;
+      float cloud_hillshade_scalefactor = 0.2f;
+
+      // calculating slope, considers cloud colors as topography
+      // (adds plastic effect to clouds, giving cumulus shapes more 3D appearance)
+      int NDIM = 3;         // cloudMap has 3 rgb values
+      bool average = true;  // uses a smoother averaged value
+      float slope,aspect;
+      // workaround: since cloudMap is unsigned char and topoMap is float, converting one to another would be overhead
+      //             instead, for NDIM == 3 we assume unsigned char cloudMap, NDIM == 1 we assume single float topoMap
+      float *dummy = NULL;         // cloud is unsigned char array, float array not needed for NDIM == 3
+
+      // slope & aspect
+      get_topo_slope(NDIM,dummy,cloudMap,surfaceMapWidth,surfaceMapHeight,p.tx,p.ty,cloud_hillshade_scalefactor,&slope,&aspect,average);
+
+      // shade
+      get_shade(slope,aspect,p.p_azimuth,p.p_elevation,sun,longitude,&shaded);
+
+      // bounds
+      if (shaded < 0.0f) shaded = 0.0f;
+
+      //shaded = hillshade_intensity * lightanglefactor * diffuselight_intensity * shaded;
+      if (p.lightanglefactor > 0.0f){
+        shaded = cloud_hillshade_intensity * p.lightanglefactor * shaded;
+      }else{
+        shaded = 0.0f;
+      }
 
-    //shaded = hillshade_intensity * lightanglefactor * diffuselight_intensity * shaded;
-    if (lightanglefactor > 0.0f){
-      shaded = cloud_hillshade_intensity * lightanglefactor * shaded;
-    }else{
-      shaded = 0.0f;
+      if (baselayer.mode == BASELAYER_RECORD) baselayer.cloudshade[geometry.index(p.img_i,p.img_j)] = shaded;
     }
 
     if (verbose){
-      if (img_i == image_w/2 && img_j == image_h/2)
+      if (p.img_i == image_w/2 && p.img_j == image_h/2)
         std::cerr << "clouds shaded: " << shaded << std::endl;
         //std::cerr << "shaded: " << shaded << " azimuth " << azimuth*180./pi << " altitude " << altitude*180./pi << std::endl;
     }
@@ -2858,7 +3526,7 @@ void RenderOnSphere::addClouds(){
     // checks pixel color
     // yellowish pixel for night lights
     //if (imagebuffer[index] > 200 && imagebuffer[index+1] > 200 && imagebuffer[index+2] < 100) is_light = true;
-    if (imagebuffer[index] > 200 && imagebuffer[index+1] > 200 && imagebuffer[index+2] > 200) is_light = true;
+    if (imagebuffer[p.index] > 200 && imagebuffer[p.index+1] > 200 && imagebuffer[p.index+2] > 200) is_light = true;
     if (is_light){
       // yellowish cloud in case city lights from below
       rgb[0] = 255.0f; rgb[1] = 244.0f; rgb[2] = 214.0f;
@@ -2877,98 +3545,94 @@ void RenderOnSphere::addClouds(){
 
     // adds to buffer
     int color;
-    color = (int)((float)imagebuffer[index  ]*shadow + (cval+shaded)*lightfactor*rgb[0]);
+    color = (int)((float)imagebuffer[p.index  ]*shadow + (cval+shaded)*lightfactor*rgb[0]);
     if (color > 255) color = 255;
-    imagebuffer[index  ] = color;
+    imagebuffer[p.index  ] = color;
 
-    color = (int)((float)imagebuffer[index+1]*shadow + (cval+shaded)*lightfactor*rgb[1]);
+    color = (int)((float)imagebuffer[p.index+1]*shadow + (cval+shaded)*lightfactor*rgb[1]);
     if (color > 255) color = 255;
-    imagebuffer[index+1] = color;
+    imagebuffer[p.index+1] = color;
 
-    color = (int)((float)imagebuffer[index+2]*shadow + (cval+shaded)*lightfactor*rgb[2]);
+    color = (int)((float)imagebuffer[p.index+2]*shadow + (cval+shaded)*lightfactor*rgb[2]);
     if (color > 255) color = 255;
-    imagebuffer[index+2] = color;
+    imagebuffer[p.index+2] = color;
 
-    // adds light to neighbor pixels
+    // adds light to neighbor pixels, left and above (after all pixels are rendered, see applyCloudGlows)
     if (is_light){
-      if (index > 0){
-        // pixel left
-        int ii = index-3;
-        if (ii < 0) ii = 0;
+      CloudGlow glow;
+      glow.index = p.index;
+      glow.shadow = shadow;
+      for (int k=0; k<3; k++) glow.light[k] = (cval+shaded)*lightfactor*rgb[k];
+      p.glows.push_back(glow);
+    }
+  }
+}
 
-        color = (int)((float)imagebuffer[ii  ]*shadow + (cval+shaded)*lightfactor*rgb[0]);
-        if (color > 255) color = 255;
-        imagebuffer[ii  ] = color;
 
-        color = (int)((float)imagebuffer[ii+1]*shadow + (cval+shaded)*lightfactor*rgb[1]);
-        if (color > 255) color = 255;
-        imagebuffer[ii+1] = color;
+// adds cloud glows of a pixel loop thread
 
-        color = (int)((float)imagebuffer[ii+2]*shadow + (cval+shaded)*lightfactor*rgb[2]);
-        if (color > 255) color = 255;
-        imagebuffer[ii+2] = color;
-      }
+void RenderOnSphere::addCloudGlows(const PixelContext &p){
+  cloudglows.insert(cloudglows.end(),p.glows.begin(),p.glows.end());
+}
 
-      if (index > image_w*3){
-        // pixel below
-        int ii = index - image_w*3;
-        if (ii < 0) ii = 0;
+// applies cloud glows to the pixels left, above and above left of each light, in the order of the
+// lights in the image. neighbor pixels of a light may belong to other tiles, which can only take the
+// glow once they are rendered. the result is the same as when each light adds its glow right away
+// while rendering the image row by row.
 
-        color = (int)((float)imagebuffer[ii  ]*shadow + (cval+shaded)*lightfactor*rgb[0]);
-        if (color > 255) color = 255;
-        imagebuffer[ii  ] = color;
+static bool glowBefore(const CloudGlow &a, const CloudGlow &b){ return a.index < b.index; }
 
-        color = (int)((float)imagebuffer[ii+1]*shadow + (cval+shaded)*lightfactor*rgb[1]);
-        if (color > 255) color = 255;
-        imagebuffer[ii+1] = color;
+void RenderOnSphere::applyCloudGlows(){
+  TRACE("renderOnSphere::applyCloudGlows")
 
-        color = (int)((float)imagebuffer[ii+2]*shadow + (cval+shaded)*lightfactor*rgb[2]);
-        if (color > 255) color = 255;
-        imagebuffer[ii+2] = color;
-      }
+  std::sort(cloudglows.begin(),cloudglows.end(),glowBefore);
 
-      if (index > image_w*3){
-        // pixel below left
-        int ii = index - image_w*3 - 3;
-        if (ii < 0) ii = 0;
+  for (size_t n=0; n<cloudglows.size(); n++){
+    const CloudGlow &glow = cloudglows[n];
 
-        color = (int)((float)imagebuffer[ii  ]*shadow + (cval+shaded)*lightfactor*rgb[0]);
-        if (color > 255) color = 255;
-        imagebuffer[ii  ] = color;
+    // pixel left, pixel below (in image buffer: row above), pixel below left
+    int neighbors[3] = { -1, -1, -1 };
+    if (glow.index > 0) neighbors[0] = glow.index-3;
+    if (glow.index > image_w*3){
+      neighbors[1] = glow.index - image_w*3;
+      neighbors[2] = glow.index - image_w*3 - 3;
+    }
 
-        color = (int)((float)imagebuffer[ii+1]*shadow + (cval+shaded)*lightfactor*rgb[1]);
-        if (color > 255) color = 255;
-        imagebuffer[ii+1] = color;
+    for (int k=0; k<3; k++){
+      int ii = neighbors[k];
+      if (ii < 0) continue;
 
-        color = (int)((float)imagebuffer[ii+2]*shadow + (cval+shaded)*lightfactor*rgb[2]);
+      for (int c=0; c<3; c++){
+        int color = (int)((float)imagebuffer[ii+c]*glow.shadow + glow.light[c]);
         if (color > 255) color = 255;
-        imagebuffer[ii+2] = color;
+        imagebuffer[ii+c] = color;
       }
     }
   }
+  cloudglows.clear();
 }
 
 
-void RenderOnSphere::addContour(){
+void RenderOnSphere::addContour(const PixelContext &p) const{
   TRACE("renderOnSphere::addContour")
   if (drawContour) {
-    if (linemecontour) {
-      imagebuffer[index  ] = 255;
-      imagebuffer[index+1] = 255;
-      imagebuffer[index+2] = 255;
+    if (p.linemecontour) {
+      imagebuffer[p.index  ] = 255;
+      imagebuffer[p.index+1] = 255;
+      imagebuffer[p.index+2] = 255;
     }
   }
 }
 
 
-void RenderOnSphere::addBackglow(){
+void RenderOnSphere::addBackglow(const PixelContext &p) const{
   TRACE("renderOnSphere::addBackglow")
 
   // backglow
   // checks if anything to do
   if (! backglow){ return; }
 
-  float pz = px*px + py*py;
+  float pz = p.px*p.px + p.py*p.py;
 
   if (pz >= 1.0 && pz <= backglow_falloff) {
     // backglow fades out from outer rim of earth sphere circle
@@ -2977,7 +3641,7 @@ void RenderOnSphere::addBackglow(){
     if (backglow_corona){
       // corona-like backglow
       // azimuth clockwise from north
-      float az = atan2(px,py);  // between [-pi,pi]
+      float az = atan2(p.px,p.py);  // between [-pi,pi]
       az *= 180.0/pi; // in degrees
       if (az < 0.0) az += 360.0;
       if (az > 360.0) az -= 360.0;
@@ -3064,9 +3728,9 @@ void RenderOnSphere::addBackglow(){
 
       // gray colorscale
       float v = pow(falloff,0.8)*backglow_intensity;
-      imagebuffer[index  ] = (int)(v*rgb[0] + (1.0-v)*background_color[0]);
-      imagebuffer[index+1] = (int)(v*rgb[1] + (1.0-v)*background_color[1]);
-      imagebuffer[index+2] = (int)(v*rgb[2] + (1.0-v)*background_color[2]);
+      imagebuffer[p.index  ] = (int)(v*rgb[0] + (1.0-v)*background_color[0]);
+      imagebuffer[p.index+1] = (int)(v*rgb[1] + (1.0-v)*background_color[1]);
+      imagebuffer[p.index+2] = (int)(v*rgb[2] + (1.0-v)*background_color[2]);
     }else{
       // simply fades out
       // makes sure factor stays within limits [0,1]
@@ -3074,29 +3738,32 @@ void RenderOnSphere::addBackglow(){
       if (falloff < 0.0) falloff = 0.0;
       // adds backglow to background
       float v = falloff * backglow_intensity;
-      imagebuffer[index  ] = (int)(v*backglow_color[0] + (1.0-v)*background_color[0]);
-      imagebuffer[index+1] = (int)(v*backglow_color[1] + (1.0-v)*background_color[1]);
-      imagebuffer[index+2] = (int)(v*backglow_color[2] + (1.0-v)*background_color[2]);
+      imagebuffer[p.index  ] = (int)(v*backglow_color[0] + (1.0-v)*background_color[0]);
+      imagebuffer[p.index+1] = (int)(v*backglow_color[1] + (1.0-v)*background_color[1]);
+      imagebuffer[p.index+2] = (int)(v*backglow_color[2] + (1.0-v)*background_color[2]);
     }
   }
 
   if (use_elevation){
     // in case the pixel height is zero, it is supposed at the outer rim of the hemisphere
-    if (pHeight <= 0.0f && (px_org*px_org+py_org*py_org) <= 1.0){
+    if (p.pHeight <= 0.0f && (p.px_org*p.px_org+p.py_org*p.py_org) <= 1.0){
       // equals to backglow at innermost location
       float falloff = backglow_intensity;
       if (falloff > 1.0) falloff = 1.0;
       if (falloff < 0.0) falloff = 0.0;
-      imagebuffer[index  ] = (int)(falloff*backglow_color[0] + (1.0-falloff)*background_color[0]);
-      imagebuffer[index+1] = (int)(falloff*backglow_color[1] + (1.0-falloff)*background_color[1]);
-      imagebuffer[index+2] = (int)(falloff*backglow_color[2] + (1.0-falloff)*background_color[2]);
+      imagebuffer[p.index  ] = (int)(falloff*backglow_color[0] + (1.0-falloff)*background_color[0]);
+      imagebuffer[p.index+1] = (int)(falloff*backglow_color[1] + (1.0-falloff)*background_color[1]);
+      imagebuffer[p.index+2] = (int)(falloff*backglow_color[2] + (1.0-falloff)*background_color[2]);
     }
   }
 }
 
 
-void RenderOnSphere::createHalfimage(){
-  TRACE("renderOnSphere::annotateImage")
+void RenderOnSphere::createHalfimage(FrameImage &frame){
+  TRACE("renderOnSphere::createHalfimage")
+
+  unsigned char *imagebuffer = frame.image;
+  unsigned char *halfimagebuffer = frame.halfimage;
 
   // fills half image buffer
   if (halfimagebuffer != NULL) {
@@ -3128,11 +3795,11 @@ void RenderOnSphere::createHalfimage(){
     // annotate half image!
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     if (addScale)
-      addScaleToImage( maxScale, halfimagebuffer,halfWidth, halfHeight,
+      addScaleToImage( frame.maxScale, halfimagebuffer,halfWidth, halfHeight,
                        halfWidth-80*boldfactor/2, 40*boldfactor/2, timeTextColor, verbose, boldfactor/2);
 
     if (addTime)
-      addTimeToImage( nframe, stepTime, startTime, halfimagebuffer,
+      addTimeToImage( frame.nframe, stepTime, startTime, halfimagebuffer,
                       halfWidth, halfHeight, halfWidth-timePosW, halfHeight-timePosH, timeTextColor, verbose, boldfactor/2);
 
     if (annotate && annotationImageBuffer != NULL)
@@ -3145,15 +3812,21 @@ void RenderOnSphere::createHalfimage(){
 
 
 
-void RenderOnSphere::annotateImage(){
+void RenderOnSphere::annotateImage(FrameImage &frame){
   TRACE("renderOnSphere::annotateImage")
 
+  unsigned char *imagebuffer = frame.image;
+  unsigned char *halfimagebuffer = frame.halfimage;
+
   // cities
+  // (overlapping labels of a fixed view get checked with the first frame; processes rendering
+  //  only some of the frames, in any order, check them for each frame)
+  bool recheckframes = rotateglobe || workers > 1 || ! renderframes.empty() || queuedir != NULL;
   if (renderCityNames)
     addCitiesToImage(imagebuffer,image_w,image_h,
-                     ncities,cities,cityCloseness,cityDistances,cityPositionX,cityPositionY,cityBoundingBoxes,
+                     ncities,cities,cityCloseness,frame.cityDistances,frame.cityPositionX,frame.cityPositionY,cityBoundingBoxes,
                      create_halfimage,halfimagebuffer,halfCityDistances,halfCityBoundingBoxes,
-                     rotateglobe,globe_radius_km,textColor,verbose,boldfactor);
+                     recheckframes,globe_radius_km,textColor,verbose,boldfactor);
 
   // logo
   if (annotate && annotationImageBuffer != NULL)
@@ -3162,96 +3835,210 @@ void RenderOnSphere::annotateImage(){
 
   // time
   if (addTime)
-    addTimeToImage( nframe, stepTime, startTime, imagebuffer, image_w, image_h,
+    addTimeToImage( frame.nframe, stepTime, startTime, imagebuffer, image_w, image_h,
                     image_w-timePosW, image_h-timePosH, timeTextColor, verbose, boldfactor);
 
   // color scale
   if (addScale)
-    addScaleToImage( maxScale, imagebuffer, image_w, image_h,
+    addScaleToImage( frame.maxScale, imagebuffer, image_w, image_h,
                      image_w-80*boldfactor, 40*boldfactor, timeTextColor, verbose, boldfactor);
 }
 
 
-int RenderOnSphere::outputImage(){
+int RenderOnSphere::outputImage(FrameImage &frame){
   TRACE("renderOnSphere::outputImage")
 
-  return writeImageBuffer(imageformat,frame_number,
-                          image_w,image_h,imagebuffer,
-                          halfWidth,halfHeight,halfimagebuffer);
+  return writeImageBuffer(imageformat,frame.frame_number,
+                          image_w,image_h,frame.image,
+                          halfWidth,halfHeight,frame.halfimage);
 }
 
 
-void RenderOnSphere::rotateGlobe(){
-  TRACE("renderOnSphere::rotateGlobe")
+// output stage: half image, annotation and file output of a rendered frame
+//
+// note: runs on the output thread of the image ring, concurrently with rendering the next frame.
+//       it only reads setup members, all frame dependent state is in frame.
 
-  if (rotateglobe) {
-    // initializes
-    float rotation = 0.0;
+int RenderOnSphere::outputFrame(FrameImage &frame){
+  TRACE("renderOnSphere::outputFrame")
 
-    // total number of frames
-    int num_frames = (frame_last - frame_first) / frame_step + 1;
+  int ret;
 
-    // total degrees of rotation
-    float total_degrees = num_frames * rotatespeed;
+  // half size image
+  {
+    ScopedTimer timer(timing,TIMING_HALFIMAGE,frame.frame_number,frame.nframe);
+    createHalfimage(frame);
+  }
 
-    int nframes_ramp;
-    float x,fac,new_speed;
-
-    // determines rotation increment
-    switch (rotatetype) {
-      case 1:
-        // constant increments
-        rotation = rotatespeed;  // rotation speed: degrees per frame
-        break;
-      case 2:
-        // cosine taper
-        if (num_frames > 1){
-          // x in range [-pi,pi]
-          x = (float)(nframe+1)/float(num_frames)*2.0*pi - pi;
-          // cosine starting at -pi == -1 -> factor in range [0,1]
-          fac = 0.5 * (cos(x) + 1.0);
-          // rotation increment
-          rotation = fac * (rotatespeed * 2.0);
-          //printf("debug: cosine rotation %f x = %f a = %f total = %f lon = %f\n",rotation,x,a,total_degrees,longitude);
-        }
-        break;
-      case 3:
-        // ramp function
-        // start/end ramp size
-        nframes_ramp = (int)( 0.1 * (float) num_frames);
-        // adapted rotation speed to reach same total number of degrees with 2 ramps
-        // new_total_degrees = new_speed * (num_frames - 2*nframes_ramp) + new_speed * nframes_ramp
-        //                   = new_speed * (num_frames - 2*nframes_ramp + nframes_ramp )
-        new_speed = total_degrees  / (num_frames - nframes_ramp);
-        if (nframe < nframes_ramp){
-          // start ramp
-          fac = (float)nframe / float(nframes_ramp);  // range [0,1]
-          rotation = fac * new_speed;
-        } else if (nframe > num_frames - nframes_ramp){
-          // end ramp
-          fac = (float)(num_frames - nframe) / float(nframes_ramp); // range [1,0]
-          rotation = fac * new_speed;
-        } else{
-          fac = 1.0f;
-          rotation = new_speed;
-        }
-        //debug
-        //printf("debug: ramp rotation %f a = %f speed %f new_speed = %f nframe %i num_frames %i ramp %i\n",
-        //       rotation,a,rotatespeed,new_speed,nframe,num_frames,nframes_ramp);
-        break;
+  // annotate cities
+  {
+    ScopedTimer timer(timing,TIMING_ANNOTATE,frame.frame_number,frame.nframe);
+    annotateImage(frame);
+  }
+
+  // file output
+  {
+    ScopedTimer timer(timing,TIMING_WRITE,frame.frame_number,frame.nframe);
+    ret = outputImage(frame);
+  }
+
+  // frame done in queue with its last interlaced image
+  if (ret == 0 && framequeue.active() && frame.iinterlace == interlace_nframes) framequeue.done(frame.nframe);
+
+  return ret;
+}
+
+
+// next free image buffer to render into
+
+FrameImage* RenderOnSphere::nextImage(){
+  TRACE("renderOnSphere::nextImage")
+
+  FrameImage *frame = imagering.acquire();
+  if (frame == NULL) return NULL;
+
+  imagebuffer = frame->image;
+  halfimagebuffer = frame->halfimage;
+  return frame;
+}
 
-      default:
-        printf("rotation: unrecognized globe rotation type %d .. Please check in rotateGlobe()\n",rotatetype);
-        break;
+
+// hands rendered image together with its annotation state to the output stage
+
+void RenderOnSphere::submitImage(FrameImage *frame){
+  TRACE("renderOnSphere::submitImage")
+
+  frame->nframe = nframe;
+  frame->iinterlace = iinterlace;
+  frame->frame_number = frame_number;
+  frame->maxScale = maxScale;
+
+  if (renderCityNames && ncities > 0){
+    if (frame->cityDistances == NULL){
+      frame->cityDistances = (float *)malloc(ncities*sizeof(float));
+      frame->cityPositionX = (int *)malloc(ncities*sizeof(int));
+      frame->cityPositionY = (int *)malloc(ncities*sizeof(int));
+    }
+    memcpy(frame->cityDistances,cityDistances,ncities*sizeof(float));
+    memcpy(frame->cityPositionX,cityPositionX,ncities*sizeof(int));
+    memcpy(frame->cityPositionY,cityPositionY,ncities*sizeof(int));
+  }
+
+  imagering.submit(frame);
+}
+
+
+// waits for output stage to write all images
+
+int RenderOnSphere::finishImages(){
+  TRACE("renderOnSphere::finishImages")
+
+  return imagering.finish();
+}
+
+
+// rotation increment (in degrees) applied after each rendering of frame number frame
+
+float RenderOnSphere::rotationIncrement(int frame){
+  // initializes
+  float rotation = 0.0;
+
+  // total number of frames
+  int num_frames = (frame_last - frame_first) / frame_step + 1;
+
+  // total degrees of rotation
+  float total_degrees = num_frames * rotatespeed;
+
+  int nframes_ramp;
+  float x,fac,new_speed;
+
+  // determines rotation increment
+  switch (rotatetype) {
+    case 1:
+      // constant increments
+      rotation = rotatespeed;  // rotation speed: degrees per frame
+      break;
+    case 2:
+      // cosine taper
+      if (num_frames > 1){
+        // x in range [-pi,pi]
+        x = (float)(frame+1)/float(num_frames)*2.0*pi - pi;
+        // cosine starting at -pi == -1 -> factor in range [0,1]
+        fac = 0.5 * (cos(x) + 1.0);
+        // rotation increment
+        rotation = fac * (rotatespeed * 2.0);
+        //printf("debug: cosine rotation %f x = %f total = %f\n",rotation,x,total_degrees);
+      }
+      break;
+    case 3:
+      // ramp function
+      // start/end ramp size
+      nframes_ramp = (int)( 0.1 * (float) num_frames);
+      // adapted rotation speed to reach same total number of degrees with 2 ramps
+      // new_total_degrees = new_speed * (num_frames - 2*nframes_ramp) + new_speed * nframes_ramp
+      //                   = new_speed * (num_frames - 2*nframes_ramp + nframes_ramp )
+      new_speed = total_degrees  / (num_frames - nframes_ramp);
+      if (frame < nframes_ramp){
+        // start ramp
+        fac = (float)frame / float(nframes_ramp);  // range [0,1]
+        rotation = fac * new_speed;
+      } else if (frame > num_frames - nframes_ramp){
+        // end ramp
+        fac = (float)(num_frames - frame) / float(nframes_ramp); // range [1,0]
+        rotation = fac * new_speed;
+      } else{
+        fac = 1.0f;
+        rotation = new_speed;
+      }
+      //debug
+      //printf("debug: ramp rotation %f speed %f new_speed = %f frame %i num_frames %i ramp %i\n",
+      //       rotation,rotatespeed,new_speed,frame,num_frames,nframes_ramp);
+      break;
+
+    default:
+      printf("rotation: unrecognized globe rotation type %d .. Please check in rotateGlobe()\n",rotatetype);
+      break;
+  }
+  return rotation;
+}
+
+
+// number of renderings before current frame nframe and interlace iinterlace
+
+int RenderOnSphere::renderingsBefore(){
+  return ((nframe - frame_first) / frame_step) * interlace_nframes + (iinterlace - 1);
+}
+
+
+static double wrapDegrees(double a){
+  a = fmod(a,360.0);
+  while (a < -180.0) a += 360.0;
+  while (a > 180.0)  a -= 360.0;
+  return a;
+}
+
+
+// sets view position for current frame nframe and interlace iinterlace
+//
+// note: the view only depends on the frame number, not on previously rendered frames,
+//       thus any subset of frames can be rendered in any order.
+
+void RenderOnSphere::rotateGlobe(){
+  TRACE("renderOnSphere::rotateGlobe")
+
+  if (rotateglobe) {
+    // total rotation, increments of all preceding frames (for each interlaced rendering)
+    double rotation = 0.0;
+    for (int frame=frame_first; frame<nframe; frame+=frame_step){
+      rotation += interlace_nframes * (double)rotationIncrement(frame);
     }
+    rotation += (iinterlace - 1) * (double)rotationIncrement(nframe);
 
     // rotates longitude
     if (rotatelon){
-      longitude += rotation;
-      while (longitude < -180.0) longitude += 360.0;
-      while (longitude > 180.0)  longitude -= 360.0;
+      longitude = wrapDegrees(longitudeStart + rotation);
       //debug
-      //printf("debug: %i lon = %f total = %f\n",nframe,longitude,total_degrees);
+      //printf("debug: %i lon = %f\n",nframe,longitude);
     }
 
     // adds latitude rotation for location close to poles
@@ -3275,27 +4062,25 @@ void RenderOnSphere::rotateGlobe(){
         latitude = latitudeStart*a;
       }else{
         // only along latitudes
-        latitude += rotation;
-        while (latitude < -180.0) latitude += 360.0;
-        while (latitude > 180.0)  latitude -= 360.0;
+        latitude = wrapDegrees(latitudeStart + rotation);
       }
     }
   }
 }
 
 
+// sets sun position for current frame nframe and interlace iinterlace
+
 void RenderOnSphere::rotateSun(){
   TRACE("renderOnSphere::rotateSun")
 
   // moves sun position
   if (rotatesun) {
-    double newsun[3];
-    double rotYcos = cos(rotatespeed_sun);
-    double rotYsin = sin(rotatespeed_sun);
-    newsun[0] =  rotYcos*sun[0] + rotYsin*sun[2];
-    newsun[2] = -rotYsin*sun[0] + rotYcos*sun[2];
-    sun[0] = newsun[0];
-    sun[2] = newsun[2];
+    double angle = renderingsBefore() * rotatespeed_sun;
+    double rotYcos = cos(angle);
+    double rotYsin = sin(angle);
+    sun[0] =  rotYcos*sunStart[0] + rotYsin*sunStart[2];
+    sun[2] = -rotYsin*sunStart[0] + rotYcos*sunStart[2];
   }
 }
 
@@ -3310,8 +4095,10 @@ void RenderOnSphere::cleanup() {
   if (surfaceMap != NULL) free(surfaceMap);
   if (topoMap != NULL) free(topoMap);
 
-  if (imagebuffer != NULL) free(imagebuffer);
-  if (halfimagebuffer != NULL) free(halfimagebuffer);
+  // image buffers (waits for output stage)
+  imagering.release();
+  imagebuffer = NULL;
+  halfimagebuffer = NULL;
 
   if (cityDistances != NULL) free(cityDistances);
   if (cityCloseness != NULL) free(cityCloseness);
@@ -3329,6 +4116,15 @@ void RenderOnSphere::cleanup() {
   if (wavesd != NULL) free(wavesd);
   if (interwaves != NULL) free(interwaves);
   if (interwavesc != NULL) free(interwavesc);
+  if (wavest != NULL) free(wavest);
+  if (interwavest != NULL) free(interwavest);
+
+  prefetch.release();
+  geometry.release();
+  baselayer.release();
+  framequeue.release();
+  freeWaveData(wavedata);
+  splatter.release();
 }
 
 
@@ -3360,7 +4156,10 @@ int main(int nargs, char **args) {
    
    ----------------------------------------------------------------------------------------------- */
   // loads textures
-  ret = renderer.loadMaps();
+  {
+    ScopedTimer timer(renderer.timing,TIMING_LOADMAPS);
+    ret = renderer.loadMaps();
+  }
   if (ret != 0) return ret;
 
   // load in annotation image
@@ -3376,10 +4175,14 @@ int main(int nargs, char **args) {
    
    ----------------------------------------------------------------------------------------------- */
   // sets dimensions for wavefield rendering
-  wavesOnMapWidth  = renderer.surfaceMapWidth / renderer.textureMapToWavesMapFactor;
-  wavesOnMapHeight = renderer.surfaceMapHeight / renderer.textureMapToWavesMapFactor;
+  splatter.wavesOnMapWidth  = renderer.surfaceMapWidth / renderer.textureMapToWavesMapFactor;
+  splatter.wavesOnMapHeight = renderer.surfaceMapHeight / renderer.textureMapToWavesMapFactor;
 
-  renderer.setupSplatter(nargs,args);
+  {
+    ScopedTimer timer(renderer.timing,TIMING_SPLATSETUP);
+    ret = renderer.setupSplatter(nargs,args);
+  }
+  if (ret != 0) return ret;
 
   /* -----------------------------------------------------------------------------------------------
    
@@ -3423,9 +4226,34 @@ int main(int nargs, char **args) {
    // - - - - - - - - - - - - - - - - - - - - - - - - for each frame -  - - - - - - - - - - - -
    
    ----------------------------------------------------------------------------------------------- */
-  renderer.frame_number = 0;
+  // frame queue
+  ret = renderer.setupQueue(nargs,args);
+  if (ret != 0) return ret;
 
-  for (renderer.nframe=frame_first; renderer.nframe<=frame_last; renderer.nframe+=frame_step) {
+  // frame farm: worker processes render the frames below, this process waits for them
+  if (renderer.workers > 1){
+    ret = renderer.forkWorkers();
+    if (renderer.worker < 0){
+      renderer.cleanup();
+      return ret;
+    }
+  }
+
+  // output stage
+  renderer.startImageOutput();
+
+  renderer.nframe = renderer.claimFrame(true);
+
+  // error while rendering: leaves the frame loop, the output stage still gets stopped below
+  int status = 0;
+
+  while (renderer.nframe <= frame_last && status == 0) {
+
+    // claims next frame ahead, read and splatted while this one renders
+    renderer.nextframe = renderer.claimFrame();
+
+    // output numbering as with all frames (frames not selected by -renderframes or rendered by other workers are skipped)
+    renderer.frame_number = ((renderer.nframe - frame_first) / frame_step) * renderer.interlace_nframes;
 
     // user output
     renderer.printFrameInfo();
@@ -3435,141 +4263,202 @@ int main(int nargs, char **args) {
       // interlacing info
       renderer.printInterlaceInfo();
 
+      // next free image buffer (waits until output stage has written it)
+      FrameImage *frame = renderer.nextImage();
+      if (frame == NULL){ status = 1; break; }
+
+      // globe and sun position for this frame
+      renderer.rotateGlobe();
+      renderer.rotateSun();
+
       // setup
-      renderer.setupFrame();
+      {
+        ScopedTimer timer(renderer.timing,TIMING_SETUP,renderer.frame_number,renderer.nframe);
+        renderer.setupFrame();
+      }
 
       bool do_error = false;
 
+      renderer.timing.beginPixels();
+
 #if defined(_OPENMP)
-      // note: the static class members like imagebuffer, cityDistances, .. are made shared(..) by OpenMP
-      //       thus, we only need to explicitly specify do_error as shared.
+      // note: the renderer holds the parameters of the frame and is shared read-only by all threads
+      //       (the pixel passes are const), the state of the pixel being rendered lives in a
+      //       PixelContext owned by the thread. the static class members like imagebuffer, cityDistances, ..
+      //       are shared(..) by OpenMP as well.
       //
       //       also: always, always use default(none) for OpenMP. we all have some sort of variable blindness.
-#pragma omp parallel for default(none) shared(do_error) private(ret) firstprivate(renderer)
+      //
+      //       tiles go to threads one at a time (dynamic schedule), most expensive first (see renderTiles.h).
+#pragma omp parallel for default(none) shared(do_error,renderer) private(ret) schedule(dynamic,1)
 #endif
-      for (int j=0; j < renderer.image_h; j++) {
-        for (int i=0; i < renderer.image_w; i++) {
+      for (int n=0; n < renderer.tiles.size(); n++) {
+        const RenderTile &tile = renderer.tiles[n];
 
-          // pixel position
-          renderer.determinePixel(i,j);
+        // soft loop stop, because OpenMP doesn't like breaking out...
+        if (do_error) continue;
 
-          if (renderer.pixelIsOnSphere()){
-            // sets up pixel location within sphere
-            renderer.setupPixelOnSphere();
+        // state of pixel being rendered
+        PixelContext pixel;
 
-            /* -----------------------------------------------------------------------------------------------
+        double busy = renderer.pixelClock();
 
-            // adds earth map
+        for (int j=tile.y0; j < tile.y1; j++) {
 
-            ----------------------------------------------------------------------------------------------- */
-            // adds globe surface
-            renderer.addSurface();
+          // part of row span in tile
+          int first = std::max(renderer.spanfirst[j],tile.x0);
+          int last  = std::min(renderer.spanlast[j],tile.x1-1);
+          if (first > last){ first = tile.x1; last = tile.x1-1; }
 
-            // lines
-            renderer.addLines();
+          // background left and right of sphere and backglow
+          double t = renderer.pixelClock();
+          renderer.fillBackground(j,tile.x0,first-1);
+          renderer.fillBackground(j,last+1,tile.x1-1);
+          renderer.pixelLap(TIMING_PIXEL,t);
 
-            /* -----------------------------------------------------------------------------------------------
+          for (int i=first; i <= last; i++) {
 
-            // lights
+            t = renderer.pixelClock();
 
-            ----------------------------------------------------------------------------------------------- */
-            // diffuse lights
-            renderer.addDiffuseLights();
+            // pixel position
+            renderer.determinePixel(pixel,i,j);
+            t = renderer.pixelLap(TIMING_PIXEL,t);
 
-            // specular lightning
-            renderer.addSpecularLight();
+            if (renderer.pixelIsOnSphere(pixel)){
+              // sets up pixel location within sphere
+              renderer.setupPixelOnSphere(pixel);
+              renderer.pixelCount(TIMING_PIXELSONSPHERE);
+              t = renderer.pixelLap(TIMING_PIXEL,t);
 
-            // night map
-            renderer.addNight();
+              /* -----------------------------------------------------------------------------------------------
 
-            /* -----------------------------------------------------------------------------------------------
+              // adds earth map
 
-            // RENDERING COLOR WAVES!
+              ----------------------------------------------------------------------------------------------- */
+              if (renderer.useBaseLayer()){
+                // globe below wavefield of static view (rendered by first frame)
+                renderer.addBaseLayer(pixel);
+                t = renderer.pixelLap(TIMING_BASELAYER,t);
+              }else{
+                // adds globe surface
+                renderer.addSurface(pixel);
+                t = renderer.pixelLap(TIMING_SURFACE,t);
 
-            ----------------------------------------------------------------------------------------------- */
-            ret = renderer.addWaves();
-            if (ret != 0){
-#if defined(_OPENMP)
-#pragma omp atomic write
-#endif
-              do_error = true; // since breaking out of OpenMP is a problem
-            }
+                // lines
+                renderer.addLines(pixel);
+                t = renderer.pixelLap(TIMING_LINES,t);
 
-            // clouds
-            renderer.addClouds();
+                /* -----------------------------------------------------------------------------------------------
 
-            // contours
-            renderer.addContour();
-          } // pixel is on sphere
+                // lights
 
-          /* -----------------------------------------------------------------------------------------------
+                ----------------------------------------------------------------------------------------------- */
+                // diffuse lights
+                renderer.addDiffuseLights(pixel);
+                t = renderer.pixelLap(TIMING_LIGHTS,t);
 
-          // BACKGLOW
+                // specular lightning
+                renderer.addSpecularLight(pixel);
+                t = renderer.pixelLap(TIMING_SPECULAR,t);
 
-          ----------------------------------------------------------------------------------------------- */
-          renderer.addBackglow();
+                // night map
+                renderer.addNight(pixel);
+                renderer.storeBaseLayer(pixel);
+                t = renderer.pixelLap(TIMING_NIGHT,t);
+              }
 
-          // soft loop stop, because OpenMP doesn't like breaking out...
-          if (do_error){
-#if defined(_OPENMP)
-#pragma omp atomic write
-#endif
-            renderer.img_i = renderer.image_w;
+              /* -----------------------------------------------------------------------------------------------
+
+              // RENDERING COLOR WAVES!
+
+              ----------------------------------------------------------------------------------------------- */
+              ret = renderer.addWaves(pixel);
+              if (ret != 0){
 #if defined(_OPENMP)
 #pragma omp atomic write
 #endif
-            renderer.img_j = renderer.image_h;
-          }
+                do_error = true; // since breaking out of OpenMP is a problem
+              }
+              t = renderer.pixelLap(TIMING_WAVES,t);
 
-        } // index img_i
-      } // index img_j
+              // clouds
+              renderer.addClouds(pixel);
+              t = renderer.pixelLap(TIMING_CLOUDS,t);
 
-      // per index rendering done!
-      if (do_error){ std::cerr << "encountered an error due to NaN values, exiting... " << std::endl; return 1;}
+              // contours
+              renderer.addContour(pixel);
+              t = renderer.pixelLap(TIMING_CONTOUR,t);
+            } // pixel is on sphere
 
-      // statistic
-      renderer.printWaveStats();
+            /* -----------------------------------------------------------------------------------------------
 
-      /* -----------------------------------------------------------------------------------------------
+            // BACKGLOW
 
-      // push/pop of rendered image here!
+            ----------------------------------------------------------------------------------------------- */
+            renderer.addBackglow(pixel);
+            renderer.pixelLap(TIMING_BACKGLOW,t);
 
-      ----------------------------------------------------------------------------------------------- */
-      renderer.createHalfimage();
+          } // index img_i
+        } // index img_j
 
-      /* -----------------------------------------------------------------------------------------------
+        renderer.pixelBusy(busy);
 
-      // annotate cities
+        // wave statistics and cloud glows
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+        {
+          renderer.addWaveStats(pixel);
+          renderer.addCloudGlows(pixel);
+        }
+      } // tiles
 
-      ----------------------------------------------------------------------------------------------- */
-      renderer.annotateImage();
+      // glow of city lights into neighbor pixels, which may belong to tiles rendered later
+      renderer.applyCloudGlows();
 
-      /* -----------------------------------------------------------------------------------------------
+      renderer.timing.endPixels(renderer.frame_number,renderer.nframe);
 
-      file output
+      // per index rendering done!
+      if (do_error){ std::cerr << "encountered an error due to NaN values, exiting... " << std::endl; status = 1; break;}
 
-      ----------------------------------------------------------------------------------------------- */
-      ret = renderer.outputImage();
-      if (ret != 0) return ret;
+      // statistic
+      renderer.printWaveStats();
 
       /* -----------------------------------------------------------------------------------------------
 
-      rotate objects for next frame
+      // push/pop of rendered image here!
 
       ----------------------------------------------------------------------------------------------- */
-      // moves globe
-      renderer.rotateGlobe();
-
-      // moves sun position
-      renderer.rotateSun();
+      // half image, city annotation and file output run in the output stage,
+      // while the next frame renders into the next image buffer
+      renderer.submitImage(frame);
 
       // increase frame number
       renderer.frame_number += 1;
 
     } // iinterlace
+    if (status != 0) break;
+
+    renderer.frameDone();
+
+    // no frame left to claim ahead, waits for frames of other processes in queue
+    if (renderer.nextframe > frame_last) renderer.nextframe = renderer.claimFrame(true);
+
+    renderer.nframe = renderer.nextframe;
 
   } // frames
 
+  // waits for last images to be written (stops output thread before the renderer goes out of scope)
+  ret = renderer.finishImages();
+  if (status == 0) status = ret;
+
+  // timing report
+  if (status == 0) status = renderer.writeTiming();
+  if (status != 0){
+    renderer.cleanup();
+    return status;
+  }
+
   // timing
   //
   // using clock() gives combined time
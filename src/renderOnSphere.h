@@ -27,6 +27,9 @@
 #include <string.h>
 // #include <time.h> timing with clock()
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #if defined(_OPENMP)
 #include <omp.h>
@@ -79,8 +82,18 @@ static int colormapmode  = COLORMAP_MODE_FUNCTIONAL_BLUE_RED;
 //#undef VARIABLE_WIDTH_FONT
 #include "text/fontManager.h"
 
+#include "timing.h"
 #include "makeSplatKernel.h"
+#include "waveData.h"
+#include "splatOperator.h"
 #include "splatToImage.h"
+#include "wavePrefetch.h"
+#include "imageRing.h"
+#include "pixelGeometry.h"
+#include "baseLayer.h"
+#include "renderTiles.h"
+#include "pixelContext.h"
+#include "frameQueue.h"
 #include "annotateImage.h"
 #include "fileIO.h"
 #include "cities.h"
@@ -374,7 +387,7 @@ inline void get_topo_slope(int NDIM, float *map, unsigned char *map3dim,
 
 inline void get_shade(float slope, float aspect,
                       double p_azimuth,double p_elevation,
-                      double *sun,double longitude,
+                      const double *sun,double longitude,
                       float *shaded){
   // coordinate frames:
   //  front hemisphere with zenith pointing to equatorial (0,0)
@@ -473,7 +486,7 @@ void addHillshading(unsigned char *imagebuffer,int image_w,int image_h,unsigned
                     float *topoMap,int surfaceMapWidth,int surfaceMapHeight,
                     int tx, int ty, int i, int j, int index,
                     double p_azimuth,double p_elevation,
-                    double *sun,double longitude,
+                    const double *sun,double longitude,
                     float hillshade_scalefactor,float hillshade_intensity,
                     float lightanglefactor,
                     bool verbose=false){
@@ -700,7 +713,20 @@ class RenderOnSphere{
     //       until somebody finds out a better way to interpolate and track the wavefront between snapshots
     const bool interlaced_waves = false;
 
-    bool linemecontour = false;
+    // reads next wavefield frame ahead on a separate thread
+    bool use_prefetch = true;
+
+    // image buffers in ring between rendering and output stage
+    int outputbuffers = 2;
+
+    // caches pixel positions on the globe for views that do not rotate
+    bool use_geometrycache = true;
+
+    // caches globe below wavefield for views where globe and sun do not rotate
+    bool use_baselayer = true;
+
+    // size of render tiles taken by OpenMP threads (in pixels)
+    int tilesize = 64;
 
     // verbose output
     bool verbose = false;
@@ -748,42 +774,29 @@ class RenderOnSphere{
     int cityBoundingBoxHeight;
 
     double globe_radius_km;
-    double lightanglefactor;
-
-    float albedo;
-    float cloud_intensity;
-    float surfaceMap_gray_intensity = 1.0f;
-
-    int tx,ty;
-    int tx_w,ty_w,idx_w;
-    int index;
-
-    float px,py,pz;
-    float px_org,py_org;
-    float pHeight;
-
-    double pyDepth;
-    double px_rot,py_rot,pz_rot;
-    double p_azimuth,p_elevation;
 
+    // view rotation of frame
     double t1,t3,t5,t8;
 
-    bool water;
-
     double longitudeStart;
     double latitudeStart;
+    double sunStart[3];
 
     // statistics
     double maxScale = 0.0f;
     // min/max after wave value has been power scaled
     float waves_val_min = 1.e10;
     float waves_val_max = -1.e10;
-    float waves_min;
-    float waves_max;
+    float waves_min = 0.0f;
+    float waves_max = 0.0f;
+
+    // cloud glows of frame (see applyCloudGlows)
+    std::vector<CloudGlow> cloudglows;
 
     // image buffers
     static unsigned char *imagebuffer;
     static unsigned char *halfimagebuffer;
+    static ImageRing imagering;  // rendered images waiting for output stage
 
     // maps
     static unsigned char *surfaceMap;
@@ -793,10 +806,23 @@ class RenderOnSphere{
     // wavefield data
     static float *waves;  // wavefield
     static short *wavesc; // waves splat count
+    static unsigned char *wavest; // active wave map tiles
     static unsigned short *wavesd; // distances, used only for cutoff option
+    static WaveData wavedata;      // frame data read buffer
+    static WavePrefetch prefetch;  // reads and splats next frame while rendering
+
+    // pixel positions on the globe of a static view
+    static PixelGeometry geometry;
+
+    // globe below wavefield of a static view
+    static BaseLayer baselayer;
 
     float *interwaves = NULL;  // wavefield
     short *interwavesc = NULL; // waves splat count
+    unsigned char *interwavest = NULL; // active wave map tiles
+
+    // wave blending of inactive tiles can be skipped (zero waves leave pixels unchanged)
+    bool skipinactivewaves = false;
 
   public:
 
@@ -804,6 +830,13 @@ class RenderOnSphere{
     static int image_w;
     static int image_h;
 
+    // pixels of each row on sphere or backglow, others show background
+    static std::vector<int> spanfirst;
+    static std::vector<int> spanlast;
+
+    // tiles of pixel loop
+    static RenderTiles tiles;
+
     static double latitude;
     static double longitude;
 
@@ -819,7 +852,26 @@ class RenderOnSphere{
     int iinterlace;
     int interlace_nframes = 1;
 
-    int img_i,img_j;
+    // frames to render (pairs of first,last frame numbers, empty for all)
+    static std::vector<int> renderframes;
+
+    // frame numbers to render, claimed in turn
+    static std::vector<int> frametasks;
+    int frametask = 0;
+    int nextframe;
+
+    // frame farm (worker index in worker processes, -1 otherwise)
+    int workers = 1;
+    int worker = -1;
+    static int *framecounter; // claimed and rendered frames, shared by workers
+
+    // frame queue in spool directory
+    const char *queuedir = NULL;
+    double queuetimeout = 600.0;
+    static FrameQueue framequeue;
+
+    // per-stage timing report (-timing)
+    static Timing timing;
 
   /* -------------------------------------
 
@@ -878,7 +930,7 @@ class RenderOnSphere{
     int createImagebuffer();
 
     // wave splatter
-    void setupSplatter(int, char **);
+    int setupSplatter(int, char **);
 
     // creates city labels
     int setupCities();
@@ -888,6 +940,20 @@ class RenderOnSphere{
 
     // sets up frame
     void setupFrame();
+    void setupGeometry();
+    void setupBaseLayer();
+    void setupSpans();
+    void readWaves(int frame, float* &wv, short* &wvc, unsigned char* &wvt);
+
+    // frame selection
+    bool parseRenderFrames(const char *list);
+    bool rendersFrame(int frame);
+    int claimFrame(bool wait=false);
+
+    // frame farm
+    int setupQueue(int nargs, char **args);
+    int forkWorkers();
+    void frameDone();
 
   /* -------------------------------------
 
@@ -902,8 +968,15 @@ class RenderOnSphere{
     void printFrameInfo();
 
     // wave statistics
+    void addWaveStats(const PixelContext &p);
+    // glow of city lights under clouds
+    void addCloudGlows(const PixelContext &p);
+    void applyCloudGlows();
     void printWaveStats();
 
+    // timing report
+    int writeTiming();
+
   /* -------------------------------------
 
    pixels
@@ -911,13 +984,30 @@ class RenderOnSphere{
    --------------------------------------- */
 
     // calculates pixel position
-    void determinePixel(int,int);
+    void determinePixel(PixelContext &p, int i, int j) const;
+    void pixelPosition(int i, int j, float &x, float &y) const {
+      x = ((float)i-(float)center.x)/(float)radius;
+      y = (((float)image_h-(float)j)-(float)center.y)/(float)radius;
+    }
 
     // determines if pixel on sphere
-    bool pixelIsOnSphere();
+    bool pixelIsOnSphere(const PixelContext &p) const;
+
+    // pixels of row on sphere (and backglow)
+    bool pixelInSpan(int i, int j, bool with_backglow) const;
+    void rowSpan(int j, bool with_backglow, int &first, int &last) const;
+
+    // background outside row span
+    void fillBackground(int j, int first, int last) const;
 
     // pixel location on sphere
-    void setupPixelOnSphere();
+    void setupPixelOnSphere(PixelContext &p) const;
+
+    // timing of pixel passes (clock is zero without -timing)
+    double pixelClock() const { return timing.enabled ? timingClock() : 0.0; }
+    double pixelLap(int stage, double t) const;
+    void pixelBusy(double t) const;
+    void pixelCount(int counter) const { if (timing.enabled) timing.addThread(counter,1.0); }
 
   /* -------------------------------------
 
@@ -926,31 +1016,37 @@ class RenderOnSphere{
    --------------------------------------- */
 
     // adds globe surface
-    void addSurface();
+    void addSurface(PixelContext &p) const;
 
     // lines
-    void addLines();
+    void addLines(const PixelContext &p) const;
 
     // diffuse lights
-    void addDiffuseLights();
+    void addDiffuseLights(PixelContext &p) const;
 
     // specular light
-    void addSpecularLight();
+    void addSpecularLight(const PixelContext &p) const;
 
     // night map
-    void addNight();
+    void addNight(const PixelContext &p) const;
+
+    // globe below wavefield of static view
+    bool useBaseLayer() const { return baselayer.mode == BASELAYER_REPLAY; }
+    void storeBaseLayer(const PixelContext &p) const;
+    void addBaseLayer(PixelContext &p) const;
 
     // waves
-    int addWaves();
+    int addWaves(PixelContext &p) const;
+    bool zeroWavesUnchanged();
 
     // clouds
-    void addClouds();
+    void addClouds(PixelContext &p) const;
 
     // contours
-    void addContour();
+    void addContour(const PixelContext &p) const;
 
     // backglow
-    void addBackglow();
+    void addBackglow(const PixelContext &p) const;
 
   /* -------------------------------------
 
@@ -959,13 +1055,22 @@ class RenderOnSphere{
    --------------------------------------- */
 
     // fills halfimage buffer
-    void createHalfimage();
+    void createHalfimage(FrameImage &frame);
 
     // adds annotations
-    void annotateImage();
+    void annotateImage(FrameImage &frame);
 
     // file output
-    int outputImage();
+    int outputImage(FrameImage &frame);
+
+    // output stage (half image, annotations, file output)
+    int outputFrame(FrameImage &frame);
+
+    // image ring
+    void startImageOutput();
+    FrameImage* nextImage();
+    void submitImage(FrameImage *frame);
+    int finishImages();
 
   /* -------------------------------------
 
@@ -974,6 +1079,8 @@ class RenderOnSphere{
    --------------------------------------- */
 
     // moves Globe
+    float rotationIncrement(int frame);
+    int renderingsBefore();
     void rotateGlobe();
 
     // moves Sun
@@ -993,6 +1100,16 @@ class RenderOnSphere{
 // image buffers
 unsigned char* RenderOnSphere::imagebuffer = NULL;
 unsigned char* RenderOnSphere::halfimagebuffer = NULL;
+ImageRing RenderOnSphere::imagering;
+
+// frames
+std::vector<int> RenderOnSphere::renderframes;
+std::vector<int> RenderOnSphere::frametasks;
+int* RenderOnSphere::framecounter = NULL;
+FrameQueue RenderOnSphere::framequeue;
+
+// timing
+Timing RenderOnSphere::timing;
 
 int RenderOnSphere::image_w = 256;
 int RenderOnSphere::image_h = 256;
@@ -1019,7 +1136,15 @@ unsigned char* RenderOnSphere::cloudMap = NULL;
 // wavefield data
 float* RenderOnSphere::waves = NULL;  // wavefield
 short* RenderOnSphere::wavesc = NULL; // waves splat count
+unsigned char* RenderOnSphere::wavest = NULL; // active wave map tiles
 unsigned short* RenderOnSphere::wavesd = NULL; // distances, used only for cutoff option
+WaveData RenderOnSphere::wavedata = waveDataInit(); // frame data read buffer
+WavePrefetch RenderOnSphere::prefetch; // next frame read ahead
+PixelGeometry RenderOnSphere::geometry; // pixel positions of static view
+BaseLayer RenderOnSphere::baselayer;    // globe below wavefield of static view
+std::vector<int> RenderOnSphere::spanfirst; // row spans on sphere and backglow
+std::vector<int> RenderOnSphere::spanlast;
+RenderTiles RenderOnSphere::tiles;          // tiles of pixel loop
 
 // view
 double RenderOnSphere::latitude  = 0.0;
@@ -0,0 +1,105 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// renderTiles.h
+#ifndef RENDERTILES_H
+#define RENDERTILES_H
+
+#include <vector>
+#include <algorithm>
+
+/* -----------------------------------------------------------------------------------------------
+
+render tiles
+
+ the image gets rendered in square tiles, which the OpenMP threads take one by one from a
+ dynamic schedule. pixels on the sphere run all feature passes, pixels of the backglow only the
+ backglow and the background gets filled, thus tiles through the globe center take much longer
+ than tiles at the rim or outside. the cost of each tile is estimated from the row spans on sphere
+ and backglow; with several threads, the most expensive tiles go first such that the cheap ones
+ fill up the end of the frame.
+
+ pixels get rendered independently of each other: the glow of city lights under clouds, which
+ spills into neighbor pixels, gets applied after all tiles (see applyCloudGlows). the image is thus
+ the same for any tile order and number of threads.
+
+----------------------------------------------------------------------------------------------- */
+
+// estimated cost of a pixel relative to a pixel on the sphere
+#define TILE_COST_SPHERE     1.0
+#define TILE_COST_BACKGLOW   0.1
+#define TILE_COST_BACKGROUND 0.005
+
+struct RenderTile {
+  int x0, x1;   // columns x0..x1-1
+  int y0, y1;   // rows y0..y1-1
+  double cost;
+};
+
+class RenderTiles {
+public:
+  RenderTiles() {}
+
+  void setup(int width, int height, int tilesize,
+             const std::vector<int> &first, const std::vector<int> &last,
+             const std::vector<int> &spherefirst, const std::vector<int> &spherelast, bool sorted);
+
+  int size() const { return (int)tiles.size(); }
+  const RenderTile& operator[](int n) const { return tiles[n]; }
+
+private:
+  std::vector<RenderTile> tiles;
+
+  static bool moreCost(const RenderTile &a, const RenderTile &b) { return a.cost > b.cost; }
+};
+
+// splits image into tiles and estimates their cost from the spans first..last of pixels on sphere
+// or backglow and spherefirst..spherelast of pixels on sphere in each row (first > last for none)
+
+void RenderTiles::setup(int width, int height, int tilesize,
+                        const std::vector<int> &first, const std::vector<int> &last,
+                        const std::vector<int> &spherefirst, const std::vector<int> &spherelast, bool sorted) {
+  TRACE("renderTiles: setup")
+
+  tiles.clear();
+  for (int y0=0; y0<height; y0+=tilesize) {
+    for (int x0=0; x0<width; x0+=tilesize) {
+      RenderTile tile;
+      tile.x0 = x0;
+      tile.x1 = std::min(x0+tilesize,width);
+      tile.y0 = y0;
+      tile.y1 = std::min(y0+tilesize,height);
+
+      double nsphere = 0.0, nspan = 0.0;
+      for (int j=tile.y0; j<tile.y1; j++) {
+        int n = std::min(last[j],tile.x1-1) - std::max(first[j],tile.x0) + 1;
+        if (n > 0) nspan += n;
+        n = std::min(spherelast[j],tile.x1-1) - std::max(spherefirst[j],tile.x0) + 1;
+        if (n > 0) nsphere += n;
+      }
+      double npixels = (double)(tile.x1-tile.x0)*(double)(tile.y1-tile.y0);
+      tile.cost = TILE_COST_SPHERE*nsphere + TILE_COST_BACKGLOW*(nspan-nsphere) +
+                  TILE_COST_BACKGROUND*(npixels-nspan);
+
+      tiles.push_back(tile);
+    }
+  }
+
+  // most expensive first (stable, keeps row order among equal tiles)
+  if (sorted) std::stable_sort(tiles.begin(),tiles.end(),moreCost);
+}
+
+#endif  // RENDERTILES_H
@@ -0,0 +1,300 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// splatOperator.h
+#ifndef SPLATOPERATOR_H
+#define SPLATOPERATOR_H
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+/* -----------------------------------------------------------------------------------------------
+
+splat operator
+
+ splatting (kernel splat, averaging, pole fill, splat passes, hole filling sweeps) is linear in
+ the wavefield values, and all of its branches depend on the splat counts only, i.e. on the
+ point coordinates. the whole chain can therefore be run once on symbolic values (SplatRow, a
+ weighted sum of wavefield points) instead of floats. the resulting wave map rows form a sparse
+ matrix (CSR) from wavefield points to wave map pixels, and a frame becomes a single sparse
+ matrix-vector product:
+
+   waves[pixel]  = sum_k weights[k] * values[cols[k]]     for rows[pixel] <= k < rows[pixel+1]
+   wavesc[pixel] = counts[pixel]
+
+ the operator can be cached in a file, which stores the splatting parameters it was derived with.
+
+----------------------------------------------------------------------------------------------- */
+
+struct SplatTerm {
+  int    point;
+  double weight;
+};
+
+inline bool operator<(const SplatTerm &a, const SplatTerm &b){ return a.point < b.point; }
+
+// weighted sum of wavefield points
+// terms get appended, and only sorted and merged once the row has grown enough
+
+class SplatRow {
+public:
+  std::vector<SplatTerm> terms;
+  size_t ncompact;
+
+  SplatRow() : ncompact(0) {}
+
+  static SplatRow unit(int point){
+    SplatRow row;
+    SplatTerm term = { point, 1.0 };
+    row.terms.push_back(term);
+    row.ncompact = 1;
+    return row;
+  }
+
+  // sorts terms by point and merges duplicates
+  void compact(){
+    if (terms.size() == ncompact) return;
+    std::sort(terms.begin(),terms.end());
+    size_t n = 0;
+    for (size_t k=0; k<terms.size(); k++) {
+      if (n > 0 && terms[n-1].point == terms[k].point) {
+        terms[n-1].weight += terms[k].weight;
+      } else {
+        terms[n++] = terms[k];
+      }
+    }
+    terms.resize(n);
+    ncompact = n;
+  }
+
+  SplatRow& operator+=(const SplatRow &row){
+    terms.insert(terms.end(),row.terms.begin(),row.terms.end());
+    if (terms.size() > 2*ncompact+64) compact();
+    return *this;
+  }
+
+  SplatRow& operator*=(double a){
+    for (size_t k=0; k<terms.size(); k++) terms[k].weight *= a;
+    return *this;
+  }
+
+  SplatRow& operator/=(double a){
+    for (size_t k=0; k<terms.size(); k++) terms[k].weight /= a;
+    return *this;
+  }
+};
+
+inline SplatRow operator*(const SplatRow &row, double a){ SplatRow r(row); r *= a; return r; }
+inline SplatRow operator*(double a, const SplatRow &row){ SplatRow r(row); r *= a; return r; }
+inline SplatRow operator/(const SplatRow &row, double a){ SplatRow r(row); r /= a; return r; }
+inline SplatRow operator+(const SplatRow &a, const SplatRow &b){ SplatRow r(a); r += b; return r; }
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// splatting parameters an operator was derived with
+
+struct SplatOperatorKey {
+  int32_t npoints;
+  int32_t width;
+  int32_t height;
+  int32_t splatkernel;
+  int32_t kernelradiusx;
+  int32_t kernelradiusy;
+  int32_t extrapasses;
+  int32_t holefillingsweeps;
+  int32_t cubedsphere;    // wave map layout
+  int32_t reserved;
+  int64_t sourcesize;     // size and modification time of coordinates file
+  int64_t sourcemtime;
+};
+
+struct SplatOperator {
+  SplatOperatorKey key;
+  int      npixels;
+  int64_t  nnz;
+  int64_t *rows;          // npixels+1 row offsets
+  int     *cols;          // wavefield point of each entry
+  float   *weights;
+  short   *counts;        // splat counts of pixels
+};
+
+SplatOperator splatOperatorInit(){
+  SplatOperator op;
+  memset(&op.key,0,sizeof(op.key));
+  op.npixels = 0;
+  op.nnz = 0;
+  op.rows = NULL;
+  op.cols = NULL;
+  op.weights = NULL;
+  op.counts = NULL;
+  return op;
+}
+
+void freeSplatOperator(SplatOperator &op){
+  if (op.rows != NULL) free(op.rows);
+  if (op.cols != NULL) free(op.cols);
+  if (op.weights != NULL) free(op.weights);
+  if (op.counts != NULL) free(op.counts);
+  op = splatOperatorInit();
+}
+
+bool allocateSplatOperator(SplatOperator &op, int npixels, int64_t nnz){
+  op.npixels = npixels;
+  op.nnz = nnz;
+  op.rows    = (int64_t *)malloc(sizeof(int64_t)*(npixels+1));
+  op.cols    = (int *)malloc(sizeof(int)*(nnz > 0 ? nnz : 1));
+  op.weights = (float *)malloc(sizeof(float)*(nnz > 0 ? nnz : 1));
+  op.counts  = (short *)malloc(sizeof(short)*npixels);
+  if (op.rows == NULL || op.cols == NULL || op.weights == NULL || op.counts == NULL) {
+    std::cerr << "Error. could not allocate splat operator with " << nnz << " entries. Exiting." << std::endl;
+    freeSplatOperator(op);
+    return false;
+  }
+  return true;
+}
+
+// sets size and modification time of the coordinates file in the key
+
+void splatOperatorSource(const char *filename, SplatOperatorKey &key){
+  struct stat st;
+  key.sourcesize = 0;
+  key.sourcemtime = 0;
+  if (filename != NULL && stat(filename,&st) == 0) {
+    key.sourcesize = (int64_t)st.st_size;
+    key.sourcemtime = (int64_t)st.st_mtime;
+  }
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+operator cache file
+
+ header    { char magic[8], int32 version, int32 npixels, SplatOperatorKey key, int64 nnz }
+ rows      int64*(npixels+1)
+ counts    short*npixels
+ cols      int32*nnz
+ weights   float*nnz
+
+----------------------------------------------------------------------------------------------- */
+
+#define SPLAT_OPERATOR_MAGIC    "SHKSPLAT"
+#define SPLAT_OPERATOR_VERSION  2
+
+struct SplatOperatorHeader {
+  char    magic[8];
+  int32_t version;
+  int32_t npixels;
+  SplatOperatorKey key;
+  int64_t nnz;
+};
+
+// reads operator from cache file, returns false if not available or derived with other parameters
+
+bool readSplatOperator(const char *filename, const SplatOperatorKey &key, SplatOperator &op){
+  FILE *fp = fopen(filename,"rb");
+  if (fp == NULL) return false;
+
+  SplatOperatorHeader header;
+  if (fread(&header,sizeof(header),1,fp) != 1 ||
+      memcmp(header.magic,SPLAT_OPERATOR_MAGIC,8) != 0 ||
+      header.version != SPLAT_OPERATOR_VERSION ||
+      memcmp(&header.key,&key,sizeof(key)) != 0 ||
+      header.npixels != key.width*key.height || header.nnz < 0) {
+    std::cerr << "splat operator: cache " << filename << " out of date" << std::endl;
+    fclose(fp);
+    return false;
+  }
+
+  if (! allocateSplatOperator(op,header.npixels,header.nnz)) {
+    fclose(fp);
+    return false;
+  }
+  op.key = key;
+
+  bool ok = fread(op.rows,sizeof(int64_t),op.npixels+1,fp) == (size_t)(op.npixels+1) &&
+            fread(op.counts,sizeof(short),op.npixels,fp) == (size_t)op.npixels &&
+            fread(op.cols,sizeof(int),op.nnz,fp) == (size_t)op.nnz &&
+            fread(op.weights,sizeof(float),op.nnz,fp) == (size_t)op.nnz &&
+            op.rows[0] == 0 && op.rows[op.npixels] == op.nnz;
+  fclose(fp);
+
+  if (! ok) {
+    std::cerr << "splat operator: could not read cache " << filename << std::endl;
+    freeSplatOperator(op);
+    return false;
+  }
+  return true;
+}
+
+bool writeSplatOperator(const char *filename, const SplatOperator &op){
+  FILE *fp = fopen(filename,"wb");
+  if (fp == NULL) {
+    std::cerr << "Warning: could not write splat operator cache " << filename << std::endl;
+    return false;
+  }
+
+  SplatOperatorHeader header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,SPLAT_OPERATOR_MAGIC,8);
+  header.version = SPLAT_OPERATOR_VERSION;
+  header.npixels = op.npixels;
+  header.key = op.key;
+  header.nnz = op.nnz;
+
+  bool ok = fwrite(&header,sizeof(header),1,fp) == 1 &&
+            fwrite(op.rows,sizeof(int64_t),op.npixels+1,fp) == (size_t)(op.npixels+1) &&
+            fwrite(op.counts,sizeof(short),op.npixels,fp) == (size_t)op.npixels &&
+            fwrite(op.cols,sizeof(int),op.nnz,fp) == (size_t)op.nnz &&
+            fwrite(op.weights,sizeof(float),op.nnz,fp) == (size_t)op.nnz;
+  if (fclose(fp) != 0) ok = false;
+
+  if (! ok) {
+    std::cerr << "Warning: could not write splat operator cache " << filename << std::endl;
+    remove(filename);
+  }
+  return ok;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// splats a frame: wave map = operator * wavefield values
+
+void applySplatOperator(const SplatOperator &op, const float *values, float *waves, short *wavesc){
+
+  const int64_t *rows = op.rows;
+  const int *cols = op.cols;
+  const float *weights = op.weights;
+  int npixels = op.npixels;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,1024) default(none) shared(npixels,rows,cols,weights,values,waves)
+#endif
+  for (int idx=0; idx<npixels; idx++) {
+    double sum = 0.0;
+    for (int64_t k=rows[idx]; k<rows[idx+1]; k++) sum += (double)weights[k]*(double)values[cols[k]];
+    waves[idx] = (float)sum;
+  }
+
+  memcpy(wavesc,op.counts,sizeof(short)*npixels);
+}
+
+#endif  // SPLATOPERATOR_H
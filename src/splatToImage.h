@@ -18,68 +18,350 @@
 #ifndef SPLATTOIMAGE_H
 #define SPLATTOIMAGE_H
 
-// bounds
-bool simmetricbounds = true;
-bool usesetbounds = false;
-double minvalbound = -1.0;
-double maxvalbound =  1.0;
-
-int ncoords = 2457602;
-
-int wavesOnMapWidth =  1800;
-int wavesOnMapHeight =  900;
-int wavesOnMapSize =   1800*900;
-
-int extrapasses = 4;
-int doholefillingsweep = 2;
-
-// kernel
-bool splatkernel = false;
-int  kernelRadiusX = 2;
-int  kernelRadiusY = 2;
-int  kernelSizeX =   2*2+1;
-int  kernelSizeY =   2*2+1;
-int *kernel = NULL;
-
-int ** adaptivekernels = NULL;
-int  * adaptivekernelsRadiusX = NULL;
-int  * adaptivekernelsSizeX = NULL;
-int  * adaptivekernelsRadiusY = NULL;
-int  * adaptivekernelsSizeY = NULL;
-
 const int   nadaptivekernels = 5;
 // max kernel radius = 255; rad=9;  255/9= 28..
 const int      adaptivekernelsize[5] =          {   1,   2,   4,  15,  28};
 const double   adaptivekernelthresholdsmin[5] = {  90,  19,  10,   5,   2};
 const double   adaptivekernelthresholdsmax[5] = {  90, 161, 170, 175, 178};
 
-// cut-off
-bool   docutoff = false;
-int    startcutoffframe = 5;
-int    endcutoffframe = 45;
-double cutoff = 20.0; // in degrees or about in km 2500.0;
+// wave map tiles (wavetilesize x wavetilesize texels) for tracking the active region of a frame
+const int wavetilesize = 16;
 
-bool usevallog = true;
+/* -----------------------------------------------------------------------------------------------
+
+cubed sphere wave map
+
+ six square faces of n x n texels, stacked vertically (map width n, height 6 n). texels are
+ equi-angular along both face axes, so that their areas differ by less than a factor 1.5, compared
+ to the equirectangular map which oversamples the poles. directions are given in the renderer
+ frame (as px_rot,py_rot,pz_rot), where equirectangular wave map coordinates (u,v) in [0,1]
+ correspond to azimuth 2 pi (0.75 - u) and elevation pi (v - 0.5).
+
+----------------------------------------------------------------------------------------------- */
+
+// face normal, first and second face axis of faces +x,-x,+y,-y,+z,-z
+static const double cubefaceaxes[6][3][3] = {
+  { { 1, 0, 0}, { 0, 0,-1}, { 0, 1, 0} },
+  { {-1, 0, 0}, { 0, 0, 1}, { 0, 1, 0} },
+  { { 0, 1, 0}, { 1, 0, 0}, { 0, 0,-1} },
+  { { 0,-1, 0}, { 1, 0, 0}, { 0, 0, 1} },
+  { { 0, 0, 1}, { 1, 0, 0}, { 0, 1, 0} },
+  { { 0, 0,-1}, {-1, 0, 0}, { 0, 1, 0} } };
+
+// wave map index of direction (x,y,z) for faces of n x n texels
+
+static inline int cubeTexelIndex(double x, double y, double z, int n){
+  double ax = fabs(x), ay = fabs(y), az = fabs(z);
+  int face;
+  if (ax >= ay && ax >= az) face = (x >= 0.0) ? 0 : 1;
+  else if (ay >= az)        face = (y >= 0.0) ? 2 : 3;
+  else                      face = (z >= 0.0) ? 4 : 5;
+
+  const double (*axes)[3] = cubefaceaxes[face];
+  double d = x*axes[0][0] + y*axes[0][1] + z*axes[0][2];
+  if (d <= 0.0) return 0;
+  double a = (x*axes[1][0] + y*axes[1][1] + z*axes[1][2])/d;
+  double b = (x*axes[2][0] + y*axes[2][1] + z*axes[2][2])/d;
+
+  // equi-angular texel position
+  int i = (int)floor((atan(a)*4.0/M_PI+1.0)*0.5*n);
+  int j = (int)floor((atan(b)*4.0/M_PI+1.0)*0.5*n);
+  if (i < 0) i = 0;
+  if (i > n-1) i = n-1;
+  if (j < 0) j = 0;
+  if (j > n-1) j = n-1;
+
+  return (face*n + j)*n + i;
+}
 
-const char * coordsfile = "translateddata/gmt_movie_coords.xy.Cb";
-const char * datafiletemplate = "translateddata/gmt_movie_%06i.v.Cb";
-char   datafilename[80];
+// direction of texel center
 
-const char * wavesfilenametemplate = "frame.%06i.ppm";
-char   wavesfilename[80];
+static inline void cubeTexelDirection(int idx, int n, double* dir){
+  int face = idx/(n*n);
+  int j = (idx/n) % n;
+  int i = idx % n;
+  double a = tan(((i+0.5)/n*2.0-1.0)*M_PI/4.0);
+  double b = tan(((j+0.5)/n*2.0-1.0)*M_PI/4.0);
 
-int  frame_first =   100;
-int  frame_last  =  7000;
-int  frame_step  =    100;
+  const double (*axes)[3] = cubefaceaxes[face];
+  double len = sqrt(1.0 + a*a + b*b);
+  for (int k=0; k<3; k++) dir[k] = (axes[0][k] + a*axes[1][k] + b*axes[2][k])/len;
+}
+
+// direction of equirectangular wave map coordinates (u,v)
+
+static inline void waveMapDirection(double u, double v, double* dir){
+  double azi = 2.0*M_PI*(0.75-u);
+  double ele = M_PI*(v-0.5);
+  dir[0] = cos(ele)*sin(azi);
+  dir[1] = sin(ele);
+  dir[2] = cos(ele)*cos(azi);
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+splat context
+
+ holds the splatter configuration and everything derived from the point coordinates (splat kernels,
+ scatter table, splat operator). it gets set up once by init(), after which splatting a frame only
+ reads it: the frame data buffer, the wave map and the value bounds of a frame belong to the caller.
+ frames can thus be splatted in any order, or concurrently into different wave maps.
+
+----------------------------------------------------------------------------------------------- */
+
+class SplatContext {
+public:
+  // bounds
+  bool simmetricbounds;
+  bool usesetbounds;
+  double minvalbound;
+  double maxvalbound;
+
+  int ncoords;
+
+  int wavesOnMapWidth;
+  int wavesOnMapHeight;
+  int wavesOnMapSize;
+
+  // cubed sphere wave map (faces of cubefacesize x cubefacesize texels, 0 for width/4)
+  bool cubedsphere;
+  int  cubefacesize;
+
+  int extrapasses;
+  int holefillingsweeps;
+
+  // kernel
+  bool splatkernel;
+  int  kernelRadiusX;
+  int  kernelRadiusY;
+
+  // cut-off
+  bool   docutoff;
+  int    startcutoffframe;
+  int    endcutoffframe;
+  double cutoff; // in degrees or about in km 2500.0;
+
+  const char * coordsfile;
+  const char * datafiletemplate;
+
+  // data file number for frame nframe: (nframe + datafileoffset) * datafilestep
+  // (e.g. bin_movie_%06i.d.gz packets are numbered by time step)
+  int  datafileoffset;
+  int  datafilestep;
+
+  // wavefield container (replaces coordsfile and datafiletemplate)
+  const char * datacontainer;
+
+  // splat operator (splatting as sparse matrix-vector product)
+  bool splatoperator;
+  bool splatoperatorcache;
+
+  // element connectivity (quads rasterized onto the wave map, replaces splatting)
+  const char * connectivityfile;
+
+  // active region: wave map tiles with values above activethreshold (relative to the frame maximum)
+  bool   activetiles;
+  double activethreshold;
+  int    ntilesx;
+  int    ntilesy;
+
+  SplatContext();
+  ~SplatContext();
+
+  bool init(bool verbose=false);
+  bool initWaves(float* &waves, short* &wavesc, unsigned char* &wavest, unsigned short* &wavesd) const;
+  bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned char* wavest, const unsigned short* wavesd,
+                         WaveData &wavedata, float &minval, float &maxval, bool verbose=false,
+                         SplatTiming *timing=NULL) const;
+  bool writeSplattedWavesPPM(int nframe, const float* waves, const short* wavesc, float minval, float maxval) const;
+  void release();
+
+  // wave map index of direction (x,y,z) in the renderer frame (cubed sphere wave map)
+  int cubeMapIndex(double x, double y, double z) const { return cubeTexelIndex(x,y,z,wavesOnMapWidth); }
+
+  // tile of wave map index
+  int waveTile(int idx) const { return (idx % wavesOnMapWidth)/wavetilesize + (idx / wavesOnMapWidth)/wavetilesize*ntilesx; }
+
+  // cubed sphere map: index of neighbor (dx,dy) of texel idx at face position (i,j), -1 if none
+  inline int cubeNeighbor(int idx, int i, int j, int dx, int dy) const;
+  // cubed sphere map: advances texel idx at face position (i,j) by one step (di,dj) along its line
+  inline void cubeStep(int &idx, int &i, int &j, int &di, int &dj) const;
+
+private:
+  // coordinates
+  float *coords;
+
+  // adaptive kernels
+  int ** adaptivekernels;
+  int  * adaptivekernelsRadiusX;
+  int  * adaptivekernelsSizeX;
+  int  * adaptivekernelsRadiusY;
+  int  * adaptivekernelsSizeY;
+
+  // scatter table: destination pixel, wavefield point and adaptive kernel of each point,
+  // sorted by pixel (coordinates are the same for all frames)
+  int   nscatter;
+  int  *scatterpixel;
+  int  *scatterpoint;
+  unsigned char *scatterkernel;
+  int  *scatterrows;     // table offset of first point in each map row (height+1 entries)
+
+  // cubed sphere map: texels beyond the face edges (up to cubehalo texels deep) on the adjacent
+  // faces, cubehalosize entries per face (-1 next to the cube corners), and for each of the three
+  // families of texel rings around the cube the face and face axis (1,2) where its rings start
+  int   cubehalo;
+  int   cubehalosize;
+  int  *cubehaloindex;
+  int   cuberingface[3];
+  int   cuberingaxis[3];
+
+  WaveContainer wavecontainer;
+  SplatOperator splatop;
+
+  bool initSplatKernels(bool verbose);
+  bool initScatterTable();
+  bool initCubeHalo();
+  bool initSplatOperator(bool verbose);
+  bool initRasterOperator(bool verbose);
+  void rasterQuad(const double* px, const double* py, const int* corners, int* pixelcorners, float* pixelweights) const;
+
+  // row of the equirectangular map at high latitude, flood filled along the whole row (see splatWaves)
+  bool polarRow(int kj) const {
+    double splatlat = ((double)kj*180.0/(double)wavesOnMapHeight);
+    return (splatlat <= adaptivekernelthresholdsmin[4] || splatlat >= adaptivekernelthresholdsmax[4]);
+  }
+
+  void initActiveRegion(const float* values, float threshold, unsigned char* tiles) const;
+  void setActiveTiles(const float* waves, const short* wavesc, float threshold, unsigned char* tiles) const;
+
+  template <typename T>
+  void splatWaves(const T* values, T* waves, short* wavesc, const unsigned char* tiles=NULL,
+                  SplatTiming *timing=NULL) const;
+  template <typename T>
+  void splatCubeKernel(const T &f, int splatindex, T* waves, short* wavesc) const;
+
+  int cubeHaloOffset(int x, int y) const;
+
+  // not copyable (owns its buffers)
+  SplatContext(const SplatContext&);
+  SplatContext& operator=(const SplatContext&);
+};
+
+SplatContext::SplatContext() {
+  simmetricbounds = true;
+  usesetbounds = false;
+  minvalbound = -1.0;
+  maxvalbound =  1.0;
+
+  ncoords = 2457602;
+
+  wavesOnMapWidth =  1800;
+  wavesOnMapHeight =  900;
+  wavesOnMapSize =   1800*900;
+
+  cubedsphere = false;
+  cubefacesize = 0;
+
+  extrapasses = 4;
+  holefillingsweeps = 2;
+
+  splatkernel = false;
+  kernelRadiusX = 2;
+  kernelRadiusY = 2;
+
+  docutoff = false;
+  startcutoffframe = 5;
+  endcutoffframe = 45;
+  cutoff = 20.0;
+
+  coordsfile = "translateddata/gmt_movie_coords.xy.Cb";
+  datafiletemplate = "translateddata/gmt_movie_%06i.v.Cb";
+  datafileoffset = 0;
+  datafilestep   = 1;
+  datacontainer = NULL;
+
+  splatoperator = false;
+  splatoperatorcache = false;
+
+  connectivityfile = NULL;
 
-bool coordsaspixels = false;
+  activetiles = true;
+  activethreshold = 0.0;
+  ntilesx = 0;
+  ntilesy = 0;
 
-float minval = 0.0f;
-float maxval = 0.0f;
+  coords = NULL;
 
-float minx,miny;
-float maxx,maxy;
-float *coords;
+  adaptivekernels = NULL;
+  adaptivekernelsRadiusX = NULL;
+  adaptivekernelsSizeX = NULL;
+  adaptivekernelsRadiusY = NULL;
+  adaptivekernelsSizeY = NULL;
+
+  nscatter = 0;
+  scatterpixel = NULL;
+  scatterpoint = NULL;
+  scatterkernel = NULL;
+  scatterrows = NULL;
+
+  cubehalo = 0;
+  cubehalosize = 0;
+  cubehaloindex = NULL;
+
+  wavecontainer = waveContainerInit();
+  splatop = splatOperatorInit();
+}
+
+SplatContext::~SplatContext() {
+  release();
+}
+
+void SplatContext::release() {
+  if (coords != NULL) free(coords);
+  coords = NULL;
+
+  if (adaptivekernels != NULL) {
+    for (int nthkernel=0; nthkernel<nadaptivekernels; nthkernel++)
+      if (adaptivekernels[nthkernel] != NULL) free(adaptivekernels[nthkernel]);
+    free(adaptivekernels);
+    free(adaptivekernelsRadiusX);
+    free(adaptivekernelsSizeX);
+    free(adaptivekernelsRadiusY);
+    free(adaptivekernelsSizeY);
+  }
+  adaptivekernels = NULL;
+  adaptivekernelsRadiusX = NULL;
+  adaptivekernelsSizeX = NULL;
+  adaptivekernelsRadiusY = NULL;
+  adaptivekernelsSizeY = NULL;
+
+  if (scatterpixel != NULL) free(scatterpixel);
+  if (scatterpoint != NULL) free(scatterpoint);
+  if (scatterkernel != NULL) free(scatterkernel);
+  if (scatterrows != NULL) free(scatterrows);
+  nscatter = 0;
+  scatterpixel = NULL;
+  scatterpoint = NULL;
+  scatterkernel = NULL;
+  scatterrows = NULL;
+
+  if (cubehaloindex != NULL) free(cubehaloindex);
+  cubehalo = 0;
+  cubehalosize = 0;
+  cubehaloindex = NULL;
+
+  closeWaveContainer(wavecontainer);
+  freeSplatOperator(splatop);
+}
+
+// splatter of the renderer
+SplatContext splatter;
+
+bool usevallog = true;
+
+int  frame_first =   100;
+int  frame_last  =  7000;
+int  frame_step  =    100;
 
 double quakelatitude  = 0;
 double quakelongitude = 0;
@@ -93,8 +375,333 @@ initSplatter  routine
 
  ----------------------------------------------------------------------------------------------- */
 
-bool initSplatter(bool verbose=false) {
-  TRACE("splatToImage: initSplatter")
+bool SplatContext::initSplatKernels(bool verbose) {
+  TRACE("splatToImage: initSplatKernels")
+
+  // checks if anything to do
+  if (! splatkernel || adaptivekernels != NULL) return true;
+  if (kernelRadiusX <= 0 || kernelRadiusY <= 0) {
+    splatkernel = false;
+    return true;
+  }
+
+  // adaptivekernels arrays
+  adaptivekernelsRadiusX = (int  *)malloc(sizeof(int  )*nadaptivekernels);
+  adaptivekernelsRadiusY = (int  *)malloc(sizeof(int  )*nadaptivekernels);
+  adaptivekernelsSizeX   = (int  *)malloc(sizeof(int  )*nadaptivekernels);
+  adaptivekernelsSizeY   = (int  *)malloc(sizeof(int  )*nadaptivekernels);
+  adaptivekernels        = (int **)calloc(nadaptivekernels,sizeof(int *));
+
+  for (int nthkernel=0; splatkernel && nthkernel<nadaptivekernels; nthkernel++) {
+    adaptivekernelsRadiusX[nthkernel] = adaptivekernelsize[nthkernel]*kernelRadiusX;
+    adaptivekernelsSizeX[nthkernel] = adaptivekernelsRadiusX[nthkernel] + adaptivekernelsRadiusX[nthkernel] + 1;
+
+    adaptivekernels[nthkernel] = (int *)malloc(sizeof(int)*adaptivekernelsSizeX[nthkernel]*adaptivekernelsSizeX[nthkernel]);
+    if (adaptivekernels[nthkernel] == NULL){
+      splatkernel = false;
+    }else {
+      // gets gaussian splat kernel
+      makeSplatKernel(adaptivekernelsRadiusX[nthkernel],adaptivekernels[nthkernel]);
+
+      adaptivekernelsRadiusY[nthkernel] = adaptivekernelsRadiusX[nthkernel];
+      adaptivekernelsSizeY[nthkernel] = adaptivekernelsSizeX[nthkernel];
+
+      // elliptic kernels w/ different Y dimension
+      bool squishKernels = true;
+      if (nthkernel > 0 && squishKernels) {
+        if (! squishKernel(adaptivekernelsRadiusY[nthkernel],adaptivekernelsRadiusY[0],adaptivekernels[nthkernel]))
+          std::cerr << "Warning: could not not allocate elliptic kernel!" << std::endl;
+
+        adaptivekernelsRadiusY[nthkernel] = adaptivekernelsRadiusY[0];
+        adaptivekernelsSizeY[nthkernel] = adaptivekernelsSizeY[0];
+      }
+    }
+  }
+
+  if (adaptivekernels[0] == NULL || ! splatkernel) {
+    std::cerr << "splat kernel could not be allocated... not splatting" << std::endl;
+    splatkernel = false;
+  } else {
+    if (verbose) std::cerr<<"  splatting kernel: " << adaptivekernelsRadiusX[0] << "::" << adaptivekernelsRadiusY[0] << std::endl;
+  }
+  return true;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+bool SplatContext::initScatterTable() {
+  TRACE("splatToImage: initScatterTable")
+
+  // coordinate range of wave map
+  const float minx = -180.0f;
+  const float maxx =  180.0f;
+  const float miny =  -90.0f;
+  const float maxy =   90.0f;
+
+  int *pixels = (int *)malloc(sizeof(int)*ncoords);
+  int *counts = (int *)calloc(wavesOnMapSize+1,sizeof(int));
+  if (pixels == NULL || counts == NULL) {
+    std::cerr << "Error. could not allocate scatter table for " << ncoords << " points. Exiting." << std::endl;
+    return false;
+  }
+
+  // pixel location of each point
+  nscatter = 0;
+  for (int idx=0;idx<ncoords;idx++) {
+    // converts coordinates given as lon/lat to pixel count location
+    // FLIP COORDS FOR IMAGE
+    int posx = (int)(((float)wavesOnMapWidth -0.0001f)*( coords[idx*2  ]-minx)/(maxx-minx));
+    int posy = (int)(((float)wavesOnMapHeight-0.0001f)*(-coords[idx*2+1]-miny)/(maxy-miny));
+
+    pixels[idx] = -1;
+
+    if (cubedsphere) {
+      // texel of cube face
+      double dir[3];
+      waveMapDirection((coords[idx*2]-minx)/(maxx-minx),(-coords[idx*2+1]-miny)/(maxy-miny),dir);
+      pixels[idx] = cubeTexelIndex(dir[0],dir[1],dir[2],wavesOnMapWidth);
+      counts[pixels[idx]+1]++;
+      nscatter++;
+      continue;
+    }
+
+    // checks position bounds
+    if (posx < 0 || posx >= wavesOnMapWidth) {
+      if (posx == wavesOnMapWidth) posx = 0;
+      if (posx == -1)              posx = wavesOnMapWidth-1;
+      if (posx < 0 || posx >= wavesOnMapWidth) {
+        std::cerr <<"DOH! w=" << posx << std::endl;
+        std::cerr << coords[idx*2  ] << " -> lat: " <<minx<<" .. " << maxx << std::endl;
+        continue;
+      }
+    }
+    if (posy < 0 || posy >= wavesOnMapHeight) {
+      if (posy == wavesOnMapHeight) posy = 0;
+      if (posy == -1)               posy = wavesOnMapHeight-1;
+      if (posy < 0 || posy >= wavesOnMapHeight) {
+        std::cerr <<  coords[idx*2  ] << "," << coords[idx*2+1] << std::endl;
+        std::cerr <<"DOH! h=" << posy << " // 0.."<< wavesOnMapHeight << std::endl;
+        continue;
+      }
+    }
+
+    // wave value index
+    pixels[idx] = posx + wavesOnMapWidth * posy;
+    counts[pixels[idx]+1]++;
+    nscatter++;
+  }
+
+  scatterpixel  = (int *)malloc(sizeof(int)*nscatter);
+  scatterpoint  = (int *)malloc(sizeof(int)*nscatter);
+  scatterkernel = (unsigned char *)malloc(sizeof(unsigned char)*nscatter);
+  if (scatterpixel == NULL || scatterpoint == NULL || scatterkernel == NULL) {
+    std::cerr << "Error. could not allocate scatter table for " << ncoords << " points. Exiting." << std::endl;
+    return false;
+  }
+
+  // sorts points by pixel (counting sort, keeps point order for points on the same pixel,
+  // so that the wave values are summed up in the same order as with the plain point loop)
+  for (int idx=0; idx<wavesOnMapSize; idx++) counts[idx+1] += counts[idx];
+
+  scatterrows = (int *)malloc(sizeof(int)*(wavesOnMapHeight+1));
+  if (scatterrows == NULL) {
+    std::cerr << "Error. could not allocate scatter table for " << ncoords << " points. Exiting." << std::endl;
+    return false;
+  }
+  for (int posy=0; posy<=wavesOnMapHeight; posy++) scatterrows[posy] = counts[posy*wavesOnMapWidth];
+
+  for (int idx=0;idx<ncoords;idx++) {
+    if (pixels[idx] < 0) continue;
+    int n = counts[pixels[idx]]++;
+    scatterpixel[n] = pixels[idx];
+    scatterpoint[n] = idx;
+  }
+  free(counts);
+  free(pixels);
+
+  // adaptive kernel by latitude (texels of the cubed sphere map all take the first kernel)
+  for (int n=0; n<nscatter; n++) {
+    if (cubedsphere) {
+      scatterkernel[n] = 0;
+      continue;
+    }
+    int posy = scatterpixel[n] / wavesOnMapWidth;
+    double splatlat = ((double)posy*180.0/(double)wavesOnMapHeight);
+
+    int nthkernel;
+    if (splatlat<=adaptivekernelthresholdsmin[4] || splatlat>=adaptivekernelthresholdsmax[4]) nthkernel=4;
+    else if (splatlat<=adaptivekernelthresholdsmin[3] || splatlat>=adaptivekernelthresholdsmax[3]) nthkernel=3;
+    else if (splatlat<=adaptivekernelthresholdsmin[2] || splatlat>=adaptivekernelthresholdsmax[2]) nthkernel=2;
+    else if (splatlat<=adaptivekernelthresholdsmin[1] || splatlat>=adaptivekernelthresholdsmax[1]) nthkernel=1;
+    else nthkernel=0;
+
+    scatterkernel[n] = (unsigned char)nthkernel;
+  }
+
+  return true;
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+cubed sphere neighbors
+
+ texels beyond an edge of a face continue on the adjacent face: the texel k steps beyond the edge
+ is the one k steps inside the adjacent face, at the same position along the edge (counted from the
+ same cube corner). there is no such texel beyond a cube corner, where only three faces meet.
+
+ lines of texels thus continue across the edges, and close into rings of four faces around the
+ cube. the rings around each of the three cube axes cover the four faces parallel to that axis.
+
+----------------------------------------------------------------------------------------------- */
+
+// offset of face position (x,y) beyond the face edges in the halo of a face: cubehalo rows below
+// and above the face (including the corners), then cubehalo columns left and right of each row
+
+int SplatContext::cubeHaloOffset(int x, int y) const {
+  const int n = wavesOnMapWidth;
+  const int h = cubehalo;
+  if (y < 0)  return (y+h)*(n+2*h) + x+h;
+  if (y >= n) return (y-n+h)*(n+2*h) + x+h;
+  return 2*h*(n+2*h) + y*2*h + (x < 0 ? x+h : x-n+h);
+}
+
+inline int SplatContext::cubeNeighbor(int idx, int i, int j, int dx, int dy) const {
+  const int n = wavesOnMapWidth;
+  int x = i+dx;
+  int y = j+dy;
+  if (x >= 0 && x < n && y >= 0 && y < n) return idx + dy*n + dx;
+  if (x < -cubehalo || x >= n+cubehalo || y < -cubehalo || y >= n+cubehalo) return -1;
+  return cubehaloindex[idx/(n*n)*cubehalosize + cubeHaloOffset(x,y)];
+}
+
+// steps across an edge onto the adjacent face turn the step (di,dj) into the direction away from
+// that edge (needs two halo texels)
+
+inline void SplatContext::cubeStep(int &idx, int &i, int &j, int &di, int &dj) const {
+  const int n = wavesOnMapWidth;
+  int x = i+di;
+  int y = j+dj;
+  if (x >= 0 && x < n && y >= 0 && y < n) {
+    idx += dj*n + di;
+    i = x;
+    j = y;
+    return;
+  }
+  const int *halo = cubehaloindex + idx/(n*n)*cubehalosize;
+  int next  = halo[cubeHaloOffset(x,y)];
+  int after = halo[cubeHaloOffset(x+di,y+dj)];
+  idx = next;
+  i = next % n;
+  j = (next/n) % n;
+  di = after % n - i;
+  dj = (after/n) % n - j;
+}
+
+bool SplatContext::initCubeHalo() {
+  TRACE("splatToImage: initCubeHalo")
+
+  const int n = wavesOnMapWidth;
+
+  // deep enough for splat passes, ring steps and the splat kernel
+  cubehalo = 2;
+  if (splatkernel) cubehalo = std::max(cubehalo,std::max(adaptivekernelsRadiusX[0],adaptivekernelsRadiusY[0]));
+  cubehalo = std::min(cubehalo,n);
+  cubehalosize = 2*cubehalo*(n+2*cubehalo) + 2*cubehalo*n;
+
+  cubehaloindex = (int *)malloc(sizeof(int)*6*cubehalosize);
+  if (cubehaloindex == NULL) {
+    std::cerr << "Error. could not allocate cubed sphere halo. Exiting." << std::endl;
+    return false;
+  }
+
+  for (int face=0; face<6; face++) {
+    const double (*axes)[3] = cubefaceaxes[face];
+    for (int y=-cubehalo; y<n+cubehalo; y++) {
+      for (int x=-cubehalo; x<n+cubehalo; x++) {
+        bool xout = (x < 0 || x >= n);
+        bool yout = (y < 0 || y >= n);
+        if (! xout && ! yout) continue;
+
+        int *halo = cubehaloindex + face*cubehalosize + cubeHaloOffset(x,y);
+        *halo = -1;
+        if (xout && yout) continue;
+
+        // crossed face axis s and its sign, steps k beyond the edge, position c along the edge (axis t)
+        int s = xout ? 1 : 2;
+        int t = 3-s;
+        int v = xout ? x : y;
+        double sign = (v >= n) ? 1.0 : -1.0;
+        int k = (v >= n) ? v-n : -1-v;
+        int c = xout ? y : x;
+
+        // adjacent face has the crossed face axis as normal
+        int next = -1;
+        for (int f=0; f<6; f++) {
+          double d = 0.0;
+          for (int m=0; m<3; m++) d += cubefaceaxes[f][0][m]*sign*axes[s][m];
+          if (d > 0.5) next = f;
+        }
+        const double (*naxes)[3] = cubefaceaxes[next];
+
+        // its face axis along our normal leads to the edge, the other one runs along the edge
+        double dnormal[3], dalong[3];
+        for (int a=1; a<3; a++) {
+          dnormal[a] = dalong[a] = 0.0;
+          for (int m=0; m<3; m++) {
+            dnormal[a] += naxes[a][m]*axes[0][m];
+            dalong[a]  += naxes[a][m]*axes[t][m];
+          }
+        }
+        int a = (fabs(dnormal[1]) > 0.5) ? 1 : 2;
+        int b = 3-a;
+        int depth = (dnormal[a] > 0.0) ? n-1-k : k;
+        int along = (dalong[b] > 0.0) ? c : n-1-c;
+        int ni = (a == 1) ? depth : along;
+        int nj = (a == 1) ? along : depth;
+
+        *halo = (next*n + nj)*n + ni;
+      }
+    }
+  }
+
+  // ring families by cube axis (of face normal x face axis), and checks that rings close
+  for (int family=0; family<3; family++) cuberingface[family] = -1;
+  for (int face=0; face<6; face++) {
+    for (int s=1; s<3; s++) {
+      const double (*axes)[3] = cubefaceaxes[face];
+      double cross[3] = { axes[0][1]*axes[s][2] - axes[0][2]*axes[s][1],
+                          axes[0][2]*axes[s][0] - axes[0][0]*axes[s][2],
+                          axes[0][0]*axes[s][1] - axes[0][1]*axes[s][0] };
+      int family = (fabs(cross[0]) > 0.5) ? 0 : ((fabs(cross[1]) > 0.5) ? 1 : 2);
+      if (cuberingface[family] >= 0) continue;
+      cuberingface[family] = face;
+      cuberingaxis[family] = s;
+    }
+  }
+  for (int family=0; family<3; family++) {
+    int s = cuberingaxis[family];
+    for (int c=0; c<n; c++) {
+      int i = (s == 1) ? 0 : c;
+      int j = (s == 1) ? c : 0;
+      int di = (s == 1) ? 1 : 0;
+      int dj = (s == 1) ? 0 : 1;
+      int idx = (cuberingface[family]*n + j)*n + i;
+      int start = idx;
+      for (int m=0; m<4*n; m++) cubeStep(idx,i,j,di,dj);
+      if (idx != start || di != ((s == 1) ? 1 : 0)) {
+        std::cerr << "Error. cubed sphere texel ring does not close. Exiting." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+bool SplatContext::init(bool verbose) {
+  TRACE("splatToImage: init")
 
   if (use_wavefield){
     std::cerr<< "wavefield: rendering frames" << std::endl;
@@ -103,24 +710,35 @@ bool initSplatter(bool verbose=false) {
   }
 
   if (use_wavefield){
+    if (cubedsphere) {
+      // six faces stacked vertically
+      if (cubefacesize <= 0) cubefacesize = wavesOnMapWidth/4;
+      cubefacesize = std::max(cubefacesize,2);
+      wavesOnMapWidth = cubefacesize;
+      wavesOnMapHeight = 6*cubefacesize;
+      std::cerr << "cubed sphere wave map: 6 faces of " << cubefacesize << " x " << cubefacesize << std::endl;
+
+      if (connectivityfile != NULL) {
+        std::cerr << "Error. element connectivity needs the equirectangular wave map. Exiting." << std::endl;
+        return false;
+      }
+    }
     wavesOnMapSize = wavesOnMapWidth*wavesOnMapHeight;
+    ntilesx = (wavesOnMapWidth +wavetilesize-1)/wavetilesize;
+    ntilesy = (wavesOnMapHeight+wavetilesize-1)/wavetilesize;
 
     /* -----------------------------------------------------------------------------------------------
      // reads in coordinate file
      ----------------------------------------------------------------------------------------------- */
-    coords = (float *)malloc(ncoords*2*sizeof(float));
-
-    // tail var 0
-    FILE *fptr= fopen(coordsfile,"rb");
-    if (fptr==NULL) {
-      std::cerr << "Error: Could not open coords file " << coordsfile << std::endl;
-      return false;
+    if (datacontainer != NULL) {
+      // container (sets ncoords)
+      if (! openWaveContainer(datacontainer,wavecontainer)) return false;
+      coords = readWaveContainerCoords(wavecontainer,ncoords);
+    } else {
+      // raw coordinates or bin_movie.xy packet (sets ncoords)
+      coords = readWaveCoords(coordsfile,ncoords);
     }
-    int ret = fread (coords,sizeof(float),ncoords*2,fptr);
-    if (ret < ncoords*2){ std::cerr << "Error. could not read coords data. Exiting." << std::endl; return false;}
-
-    fclose(fptr);
-
+    if (coords == NULL) return false;
 
     /* -----------------------------------------------------------------------------------------------
      // flips lat / lon
@@ -134,6 +752,8 @@ bool initSplatter(bool verbose=false) {
     }
 
     // determines min/max of coordinate range
+    float minx,miny;
+    float maxx,maxy;
 
     minx = maxx = coords[0];
     miny = maxy = coords[1];
@@ -153,19 +773,27 @@ bool initSplatter(bool verbose=false) {
     }
   }
 
-  minx = -180.0f;
-  maxx =  180.0f;
-  miny =  -90.0f;
-  maxy =   90.0f;
+  if (use_wavefield && connectivityfile != NULL){
+    // rasterized element quads
+    if (! initRasterOperator(verbose)) return false;
+  } else if (use_wavefield){
+    // splat kernels and point-to-pixel scatter table
+    if (! initSplatKernels(verbose)) return false;
+    if (cubedsphere && ! initCubeHalo()) return false;
+    if (! initScatterTable()) return false;
+    if (verbose) std::cerr << "scatter table: " << nscatter << " points" << std::endl;
+
+    if (! initSplatOperator(verbose)) return false;
+  }
 
   return true;
 }
 
 /* ----------------------------------------------------------------------------------------------- */
 
-bool initSplatter_waves(float* &waves, short* &wavesc, unsigned short* &wavesd) {
+bool SplatContext::initWaves(float* &waves, short* &wavesc, unsigned char* &wavest, unsigned short* &wavesd) const {
 
-  TRACE("splatToImage: initSplatter_waves")
+  TRACE("splatToImage: initWaves")
   //std::cerr<< "lon: " <<minx<<" .. " << maxx << std::endl;
   //std::cerr<< "lat: " <<miny<<" .. " << maxy << std::endl;
 
@@ -175,6 +803,8 @@ bool initSplatter_waves(float* &waves, short* &wavesc, unsigned short* &wavesd)
   // wavefield allocation
   waves  = (float *)malloc(wavesOnMapSize*sizeof(float));
   wavesc = (short *)malloc(wavesOnMapSize*sizeof(short));
+  wavest = (unsigned char *)malloc(ntilesx*ntilesy*sizeof(unsigned char));
+  if (wavest != NULL) memset(wavest,1,ntilesx*ntilesy*sizeof(unsigned char));
 
   // compute distance map
   if (docutoff && wavesd == NULL){
@@ -186,273 +816,240 @@ bool initSplatter_waves(float* &waves, short* &wavesc, unsigned short* &wavesd)
     wavesd = (unsigned short *)malloc(wavesOnMapSize*sizeof(short));
 
     // earthquake epicentral locations
-    static double radlong1 = (quakelongitude+180.0)/180.0*pi;
-    static double radlat1  =  quakelatitude/180.0*pi;
+    double radlong1 = (quakelongitude+180.0)/180.0*pi;
+    double radlat1  =  quakelatitude/180.0*pi;
 
     // earthquake location on 3D sphere
-    static double x1 = cos(radlong1)*cos(radlat1);
-    static double y1 = sin(radlat1);
-    static double z1 = sin(radlong1)*cos(radlat1);
+    double x1 = cos(radlong1)*cos(radlat1);
+    double y1 = sin(radlat1);
+    double z1 = sin(radlong1)*cos(radlat1);
 
     //fprintf(stderr,"%lf %lf",quakelongitude,quakelatitude);
-    for (int idx=0,posy=0; posy<wavesOnMapHeight; posy++) {
-      double radlat2 = (0.5-((double)posy/(double)(wavesOnMapHeight-1)))*pi;
-      double y2 = sin(radlat2);
-      for (int posx=0; posx<wavesOnMapWidth; posx++,idx++) {
-        double radlong2 = (1.0-(double)posx/(double)(wavesOnMapWidth-1 ))*2.0*pi;
+    if (cubedsphere) {
+      for (int idx=0; idx<wavesOnMapSize; idx++) {
+        // equirectangular map location of texel
+        double dir[3];
+        cubeTexelDirection(idx,wavesOnMapWidth,dir);
+        double u = 0.75 - atan2(dir[0],dir[2])/(2.0*pi);
+        double v = 0.5 + asin(dir[1])/pi;
+
+        double radlat2 = (0.5-v)*pi;
+        double radlong2 = (1.0-u)*2.0*pi;
         double x2 = cos(radlong2)*cos(radlat2);
+        double y2 = sin(radlat2);
         double z2 = sin(radlong2)*cos(radlat2);
 
-        // epicentral distance to earthquake location of this pixel location
+        // epicentral distance (in degree) to earthquake location
         double dot= x1*x2+y1*y2+z1*z2;
-        double theta = acos(dot);
-        double distance = theta * 180.0/pi; // in degree, or in km: theta*earth_radius_km;
-
-        // distance map
-        wavesd[idx] = (unsigned short) distance;
-
-        //if (posx==0 && posy%100==0) fprintf(stderr,"\n");
-        //if (posx%100==0 && posy%100==0) { fprintf(stderr,"%5i",wavesd[idx]); }
+        if (dot > 1.0) dot = 1.0;
+        if (dot < -1.0) dot = -1.0;
+        wavesd[idx] = (unsigned short) (acos(dot) * 180.0/pi);
+      }
+    } else {
+      for (int idx=0,posy=0; posy<wavesOnMapHeight; posy++) {
+        double radlat2 = (0.5-((double)posy/(double)(wavesOnMapHeight-1)))*pi;
+        double y2 = sin(radlat2);
+        for (int posx=0; posx<wavesOnMapWidth; posx++,idx++) {
+          double radlong2 = (1.0-(double)posx/(double)(wavesOnMapWidth-1 ))*2.0*pi;
+          double x2 = cos(radlong2)*cos(radlat2);
+          double z2 = sin(radlong2)*cos(radlat2);
+
+          // epicentral distance to earthquake location of this pixel location
+          double dot= x1*x2+y1*y2+z1*z2;
+          double theta = acos(dot);
+          double distance = theta * 180.0/pi; // in degree, or in km: theta*earth_radius_km;
+
+          // distance map
+          wavesd[idx] = (unsigned short) distance;
+
+          //if (posx==0 && posy%100==0) fprintf(stderr,"\n");
+          //if (posx%100==0 && posy%100==0) { fprintf(stderr,"%5i",wavesd[idx]); }
+        }
       }
     }
     // fprintf(stderr,"\n");
   }
 
-  return waves != NULL && wavesc != NULL && coords != NULL;
+  return waves != NULL && wavesc != NULL && wavest != NULL && coords != NULL;
 }
 
 
 
 /* -----------------------------------------------------------------------------------------------
 
- //               READ AND SPLAT WAVES
+ //               SPLAT WAVES
 
- // for frame #nframe
- // (all other info is global!)
+ // splats wavefield values onto the wave map (waves,wavesc)
+ // value type T is float for frames, or SplatRow to derive the splat operator
+ // points and pixels outside of the active region (tiles, NULL for the whole map) are skipped
 
  ----------------------------------------------------------------------------------------------- */
- // for (int nframe=frame_first; nframe<=frame_last; nframe+=frame_step)
-
-bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short* wavesd, bool verbose=false) {
 
-  TRACE("splatToImage: readAndSplatWaves")
-  // checks if anything to do
-  if (! use_wavefield){ return true; }
-
-  /* -----------------------------------------------------------------------------------------------
-    // reads wavefield file
-    ----------------------------------------------------------------------------------------------- */
-  sprintf(datafilename,datafiletemplate,nframe);
-  if (verbose) std::cerr<<"Processing datafile " << datafilename<<std::endl;
-
-  // opens data file
-  FILE *fptr = fopen(datafilename,"rb");
-  if (fptr == NULL) {
-    std::cerr << "Error: Could not open data file " << datafilename << std::endl;
-    return false;
+// splats the (first) kernel at texel splatindex of the cubed sphere map, with the kernel texels
+// beyond the face edges on the adjacent faces
+
+template <typename T>
+void SplatContext::splatCubeKernel(const T &f, int splatindex, T* waves, short* wavesc) const {
+  const int *skernel = adaptivekernels[0];
+  int skernelSizeX =   adaptivekernelsSizeX[0];
+  int skernelSizeY =   adaptivekernelsSizeY[0];
+  int skernelRadiusX = adaptivekernelsRadiusX[0];
+  int skernelRadiusY = adaptivekernelsRadiusY[0];
+
+  int i = splatindex % wavesOnMapWidth;
+  int j = (splatindex / wavesOnMapWidth) % wavesOnMapWidth;
+
+  int kindex = 0;
+  for (int kj=0; kj<skernelSizeY; kj++) {
+    for (int ki=0; ki<skernelSizeX; ki++,kindex++) {
+      if (skernel[kindex]<=0) continue;
+      int kernelindex = cubeNeighbor(splatindex,i,j,ki-skernelRadiusX,kj-skernelRadiusY);
+      if (kernelindex < 0) continue;
+
+      // adds gaussian kernel times wavefield values (see splatWaves)
+      if (wavesc[kernelindex]<=0) {
+        wavesc[kernelindex] -= skernel[kindex];
+        waves [kernelindex] += ((float)skernel[kindex]*f);
+      } else {
+        waves [kernelindex] += ((float)skernel[kindex]*f);
+      }
+    }
   }
+}
 
-  // initializes wavefield
-  bzero(waves ,wavesOnMapSize*sizeof(float));
-  bzero(wavesc,wavesOnMapSize*sizeof(short));
+/* ----------------------------------------------------------------------------------------------- */
 
-  float d;
-  int posx;
-  int posy;
+template <typename T>
+void SplatContext::splatWaves(const T* values, T* waves, short* wavesc, const unsigned char* tiles,
+                              SplatTiming *timing) const {
 
-  // loops over wavefield data
-  for (int idx=0;idx<ncoords;idx++) {
+  TRACE("splatToImage: splatWaves")
 
-    // coordinates of pixel
-    if (coordsaspixels) {
-      // coordinates are given in pixel format
-      posx = (int)coords[idx*2  ];
-      posy = (int)coords[idx*2+1];
-    } else {
-      // converts coordinates given as lon/lat to pixel count location
-      // FLIP COORDS FOR IMAGE
-      posx = (int)(((float)wavesOnMapWidth -0.0001f)*( coords[idx*2  ]-minx)/(maxx-minx));
-      posy = (int)(((float)wavesOnMapHeight-0.0001f)*(-coords[idx*2+1]-miny)/(maxy-miny));
-    }
+  double t = timing ? timingClock() : 0.0;
 
-    // reads in wavefield amplitude value
-    int ret = fread (&d,sizeof(float),1,fptr);
-    if (ret == 0){ std::cerr << "Error. could not read amplitude value. Exiting." << std::endl;return false;}
+  // initializes wavefield
+  for (int idx=0; idx<wavesOnMapSize; idx++) waves[idx] = T();
+  bzero(wavesc,wavesOnMapSize*sizeof(short));
 
-    // min/max statistics
-    float f = (float)d;
-    if (idx == 0){
-      minval = maxval = f;
-    }else {
-      if (f < minval) minval = f;
-      else if (f > maxval) maxval = f;
-    }
+  // splats wavefield values in scatter table order (sorted by pixel)
+  //
+  // the map rows are split into bands of at least one kernel height. points of even bands get
+  // splatted in parallel first, then the ones of odd bands, so that no two threads write to the
+  // same pixels. each pixel thus sums up its contributions in the same order for any number of
+  // threads. kernels of the cubed sphere map which reach across a face edge write into another
+  // face, so these points get splatted after the bands, one by one.
+  int kernelreach = 0;
+  if (splatkernel) {
+    for (int nthkernel=0; nthkernel<nadaptivekernels; nthkernel++)
+      if (adaptivekernelsRadiusY[nthkernel] > kernelreach) kernelreach = adaptivekernelsRadiusY[nthkernel];
+  }
+  int nbands = wavesOnMapHeight / std::max(2*kernelreach+1,16);
+  if (nbands > 1 && nbands % 2 != 0) nbands--;
+  if (nbands < 2) nbands = 1;
+
+  const bool cubekernel = cubedsphere && splatkernel;
+  const int cubeedge = cubekernel ? std::max(adaptivekernelsRadiusX[0],adaptivekernelsRadiusY[0]) : 0;
+
+  for (int phase=0; phase<3; phase++) {
+    if (phase == 2 && ! cubekernel) break;
+    if (phase == 2) nbands = 1;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+    for (int band=phase%2; band<nbands; band+=2) {
+      int nstart = scatterrows[(int64_t)band*wavesOnMapHeight/nbands];
+      int nend   = scatterrows[(int64_t)(band+1)*wavesOnMapHeight/nbands];
+
+      for (int n=nstart; n<nend; n++) {
+
+        // wave value index
+        int splatindex = scatterpixel[n];
+
+        // skips points outside of the active region
+        if (tiles != NULL && ! tiles[waveTile(splatindex)]) continue;
+
+        // kernels across cubed sphere face edges in last phase
+        if (cubekernel) {
+          int i = splatindex % wavesOnMapWidth;
+          int j = (splatindex / wavesOnMapWidth) % wavesOnMapWidth;
+          bool edge = (i < cubeedge || i >= wavesOnMapWidth-cubeedge || j < cubeedge || j >= wavesOnMapWidth-cubeedge);
+          if (edge != (phase == 2)) continue;
+        }
 
-    // checks position bounds
-    if (posx < 0 || posx >= wavesOnMapWidth) {
-      if (posx == wavesOnMapWidth) posx = 0;
-      if (posx == -1)              posx = wavesOnMapWidth-1;
-      if (posx < 0 || posx >= wavesOnMapWidth) {
-        std::cerr <<"DOH! w=" << posx << std::endl;
-        std::cerr << coords[idx*2  ] << " -> lat: " <<minx<<" .. " << maxx << std::endl;
-      }
-    }
-    if (posy < 0 || posy >= wavesOnMapHeight) {
-      if (posy == wavesOnMapHeight) posy = 0;
-      if (posy == -1)               posy = wavesOnMapHeight-1;
-      if (posy < 0 || posy >= wavesOnMapHeight) {
-        std::cerr <<  coords[idx*2  ] << "," << coords[idx*2+1] << std::endl;
-        std::cerr <<"DOH! h=" << posy << " // 0.."<< wavesOnMapHeight << std::endl;
-      }
-    }
+        // wavefield amplitude value
+        const T &f = values[scatterpoint[n]];
 
-    // wave value index
-    int splatindex = posx + wavesOnMapWidth * posy;
-
-    // check splat count. if splat count about to overflow, divide count by 2
-    if (wavesc[splatindex] >= 256*120) {
-      wavesc[splatindex] /= 2;
-      waves [splatindex] /= 2.0;
-      std::cerr <<"wave splat count big!"<<std::endl;;
-      //std::cerr <<"/";
-    }
-
-    // SPLAT !!!!!!!!!!!!!!!!!!!!!!!!!!!
-    if (splatkernel && kernelRadiusX > 0 && kernelRadiusY > 0) {
-
-      // allocates kernels
-      if (kernel == NULL) {
-        // only allocates and sets up arrays once
-        kernelSizeX = kernelRadiusX + kernelRadiusX + 1;
-        kernelSizeY = kernelRadiusY + kernelRadiusY + 1;
-
-        // adaptivekernels arrays
-        adaptivekernelsRadiusX = (int  *)malloc(sizeof(int  )*nadaptivekernels);
-        adaptivekernelsRadiusY = (int  *)malloc(sizeof(int  )*nadaptivekernels);
-        adaptivekernelsSizeX   = (int  *)malloc(sizeof(int  )*nadaptivekernels);
-        adaptivekernelsSizeY   = (int  *)malloc(sizeof(int  )*nadaptivekernels);
-        adaptivekernels        = (int **)malloc(sizeof(int *)*nadaptivekernels);
-
-        for (int nthkernel=0; splatkernel && nthkernel<nadaptivekernels; nthkernel++) {
-          adaptivekernelsRadiusX[nthkernel] = adaptivekernelsize[nthkernel]*kernelRadiusX;
-          adaptivekernelsSizeX[nthkernel] = adaptivekernelsRadiusX[nthkernel] + adaptivekernelsRadiusX[nthkernel] + 1;
-
-          adaptivekernels[nthkernel] = (int *)malloc(sizeof(int)*adaptivekernelsSizeX[nthkernel]*adaptivekernelsSizeX[nthkernel]);
-          if (adaptivekernels[nthkernel] == NULL){
-            splatkernel = false;
-          }else {
-            // gets gaussian splat kernel
-            makeSplatKernel(adaptivekernelsRadiusX[nthkernel],adaptivekernels[nthkernel]);
-
-            adaptivekernelsRadiusY[nthkernel] = adaptivekernelsRadiusX[nthkernel];
-            adaptivekernelsSizeY[nthkernel] = adaptivekernelsSizeX[nthkernel];
-
-            // elliptic kernels w/ different Y dimension
-            bool squishKernels = true;
-            if (nthkernel > 0 && squishKernels) {
-              if (! squishKernel(adaptivekernelsRadiusY[nthkernel],adaptivekernelsRadiusY[0],adaptivekernels[nthkernel]))
-                std::cerr << "Warning: could not not allocate elliptic kernel!" << std::endl;
-
-              adaptivekernelsRadiusY[nthkernel] = adaptivekernelsRadiusY[0];
-              adaptivekernelsSizeY[nthkernel] = adaptivekernelsSizeY[0];
-            }
-          }
+        // check splat count. if splat count about to overflow, divide count by 2
+        if (wavesc[splatindex] >= 256*120) {
+          wavesc[splatindex] /= 2;
+          waves [splatindex] /= 2.0;
+          std::cerr <<"wave splat count big!"<<std::endl;;
+          //std::cerr <<"/";
         }
 
-        kernel = adaptivekernels[0];
-        if (kernel == NULL) {
-          std::cerr << "splat kernel could not be allocated... not splatting" << std::endl;
-          splatkernel = false;
-        } else {
-          if (verbose) std::cerr<<"  splatting kernel: " << adaptivekernelsRadiusX[0] << "::" << adaptivekernelsRadiusY[0] << std::endl;
-          // debug
-          /*
-          if (verbose) {
-            //int kindex=0;
-            //std::cerr << adaptivekernelsRadius[0] << "::" << adaptivekernelsSize[0] << std::endl;
-            for (int kj=0; kj<kernelSizeY; kj++) {
-              for (int ki=0; ki<kernelSizeX; ki++) {
-                // fprintf(stderr,"%3i ",kernel[kindex++]);
+        // SPLAT !!!!!!!!!!!!!!!!!!!!!!!!!!!
+        if (cubekernel) {
+          splatCubeKernel(f,splatindex,waves,wavesc);
+        } else if (splatkernel) {
+          // splats kernel
+          int nthkernel = scatterkernel[n];
+          int posx = splatindex % wavesOnMapWidth;
+
+          const int *skernel = adaptivekernels[nthkernel];
+          int skernelSizeX =   adaptivekernelsSizeX[nthkernel];
+          int skernelSizeY =   adaptivekernelsSizeY[nthkernel];
+          int skernelRadiusX = adaptivekernelsRadiusX[nthkernel];
+          int skernelRadiusY = adaptivekernelsRadiusY[nthkernel];
+
+          int kindex = 0;
+          for (int kj=0; kj<skernelSizeY; kj++) {
+            int kernelrowindex = splatindex+(kj-skernelRadiusY)*wavesOnMapWidth;
+
+            if (kernelrowindex < 0)               kernelrowindex += wavesOnMapSize;
+            if (kernelrowindex >= wavesOnMapSize) kernelrowindex -= wavesOnMapSize;
+
+            for (int ki=0; ki<skernelSizeX; ki++,kindex++) {
+              if (skernel[kindex]>0) {
+                int kernelindex = kernelrowindex + (ki-skernelRadiusX);
+
+                if ((posx+(ki-skernelRadiusX))<0)
+                  kernelindex += wavesOnMapWidth;
+                else if ((posx+(ki-skernelRadiusX))>=wavesOnMapWidth)
+                  kernelindex -= wavesOnMapWidth;
+
+                // adds gaussian kernel times wavefield values
+                if (wavesc[kernelindex]<=0) {
+                  // wave value has not been set yet
+                  wavesc[kernelindex] -= skernel[kindex];
+                  waves [kernelindex] += ((float)skernel[kindex]*f);
+                } else if (wavesc[kernelindex]>0) {
+                  // wave values has been collected already
+                  waves [kernelindex] += ((float)skernel[kindex]*f);
+                }
               }
-              //std::cerr << std::endl;
             }
           }
-          */
-        }
-      }
-
-      // splats kernel
-      if (kernel != NULL) {
-        int nthkernel = 0;
-        double splatlat = ((double)posy*180.0/(double)wavesOnMapHeight);
-
-        if (splatlat<=adaptivekernelthresholdsmin[4] || splatlat>=adaptivekernelthresholdsmax[4]) nthkernel=4;
-        else if (splatlat<=adaptivekernelthresholdsmin[3] || splatlat>=adaptivekernelthresholdsmax[3]) nthkernel=3;
-        else if (splatlat<=adaptivekernelthresholdsmin[2] || splatlat>=adaptivekernelthresholdsmax[2]) nthkernel=2;
-        else if (splatlat<=adaptivekernelthresholdsmin[1] || splatlat>=adaptivekernelthresholdsmax[1]) nthkernel=1;
-        else nthkernel=0;
-
-        kernel =        adaptivekernels[nthkernel];
-        kernelSizeX =   adaptivekernelsSizeX[nthkernel];
-        kernelSizeY =   adaptivekernelsSizeY[nthkernel];
-        kernelRadiusX = adaptivekernelsRadiusX[nthkernel];
-        kernelRadiusY = adaptivekernelsRadiusY[nthkernel];
-
-        int kindex = 0;
-        for (int kj=0; kj<kernelSizeY; kj++) {
-          int kernelrowindex = splatindex+(kj-kernelRadiusY)*wavesOnMapWidth;
-
-          if (kernelrowindex < 0)               kernelrowindex += wavesOnMapSize;
-          if (kernelrowindex >= wavesOnMapSize) kernelrowindex -= wavesOnMapSize;
-
-          for (int ki=0; ki<kernelSizeX; ki++,kindex++) {
-            if (kernel[kindex]>0) {
-              int kernelindex = kernelrowindex + (ki-kernelRadiusX);
-
-              if ((posx+(ki-kernelRadiusX))<0)
-                kernelindex += wavesOnMapWidth;
-              else if ((posx+(ki-kernelRadiusX))>=wavesOnMapWidth)
-                kernelindex -= wavesOnMapWidth;
-
-              // adds gaussian kernel times wavefield values
-              if (wavesc[kernelindex]<=0) {
-                // wave value has not been set yet
-                wavesc[kernelindex] -= kernel[kindex];
-                waves [kernelindex] += ((float)kernel[kindex]*f);
-              } else if (wavesc[kernelindex]>0) {
-                // wave values has been collected already
-                waves [kernelindex] += ((float)kernel[kindex]*f);
-              }
-            }
+        }else{
+          // do not kernel splat here!
+          // you end up foward smear splatting things that may be clean splatted
+          //
+          // fills wave array
+          if (wavesc[splatindex] >= 0) {
+            // adds wave value and increases count
+            waves[splatindex] += f;
+            wavesc[splatindex]++;
+          } else {
+            // negative count, means secondary splat. so overwrite
+            // wavefield amplitudes
+            waves[splatindex] = f;
+            // splat count
+            wavesc[splatindex] = 1;
           }
         }
       }
-    }else{
-      // do not kernel splat here!
-      // you end up foward smear splatting things that may be clean splatted
-      //
-      // fills wave array
-      if (wavesc[splatindex] >= 0) {
-        // adds wave value and increases count
-        waves[splatindex] += f;
-        wavesc[splatindex]++;
-      } else {
-        // negative count, means secondary splat. so overwrite
-        // wavefield amplitudes
-        waves[splatindex] = f;
-        // splat count
-        wavesc[splatindex] = 1;
-      }
-    }
-
-    // stores coordinates in pixel format
-    coords[idx*2  ] = posx+0.0001f;
-    coords[idx*2+1] = posy+0.0001f;
-  }
-
-  fclose(fptr);
-
-  coordsaspixels = true;
+    } // band
+  } // phase
 
   /*
   if (dumpDebugSplatMap) {
@@ -475,27 +1072,6 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
   }
   */
 
-  //if (verbose)
-  fprintf(stderr,"  frames value bounds %e <--> %e\n",minval,maxval);
-
-  if (usesetbounds) {
-    fprintf(stderr,"  use bounds      : %e <--> %e\n",minvalbound,maxvalbound);
-    minval = minvalbound;
-    maxval = maxvalbound;
-  }
-
-  // used by default (see definitions on top of file)
-  if (simmetricbounds) {
-    if (minval < 0) minval=-minval;
-    if (maxval < 0) maxval=-maxval;
-    if (minval > maxval) maxval=minval;
-    minval = -maxval;
-    fprintf(stderr,"  symmetric bounds: %e <--> %e\n",minval,maxval);
-  }
-
-  if (verbose)
-  std::cerr<< "  colormap bounds: " << minval << " .. " << maxval << "   /" << maxval-minval << std::endl;
-
   const int SPLATTED = 256*128-1;
 
   // averages wavefield amplitudes by splat count
@@ -506,11 +1082,12 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
       wavesc[idx] = SPLATTED;
     }
   }
+  if (timing) t = SplatTiming::lap(timing->accumulate,t);
 
   // do flood fill for high latitutes!   lat>= +/- (90-2)deg
-  for (int kj=0; kj<wavesOnMapHeight; kj++) {
-    double splatlat = ((double)kj*180.0/(double)wavesOnMapHeight);
-    if (splatlat <= adaptivekernelthresholdsmin[4] || splatlat >= adaptivekernelthresholdsmax[4]) {
+  // (not needed for cubed sphere map)
+  for (int kj=0; kj<wavesOnMapHeight && ! cubedsphere; kj++) {
+    if (polarRow(kj)) {
       int gap = 0;
       int lastv = -1;
       int kii = kj*wavesOnMapWidth;
@@ -541,6 +1118,7 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
       } // back traverse
     } // splat size
   } // kjj
+  if (timing) t = SplatTiming::lap(timing->holefill,t);
 
   /*
   bool dumpDebugSplatMap=true;
@@ -568,101 +1146,130 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
 
    ----------------------------------------------------------------------------------------------- */
   if (extrapasses) {
+    // splatted flags at the beginning of a pass
+    unsigned char *splatted = (unsigned char *)malloc(wavesOnMapSize*sizeof(unsigned char));
+    if (splatted == NULL) {
+      std::cerr << "Error. could not allocate splat flags. Exiting." << std::endl;
+      exit(1);
+    }
+
+    const int W = wavesOnMapWidth;
+    const int H = wavesOnMapHeight;
+    // face height (neighbors of pixels next to the face edges of the cubed sphere map are on the
+    // adjacent faces)
+    const int FH = cubedsphere ? W : H;
+
+    // neighbor offsets and weights, in index order
+    static const int passneighbors[12][3] = {
+      { 0,-2,1}, {-1,-1,4}, { 0,-1,8}, { 1,-1,4}, {-2, 0,1}, {-1, 0,8},
+      { 1, 0,8}, { 2, 0,1}, {-1, 1,4}, { 0, 1,8}, { 1, 1,4}, { 0, 2,1} };
+
     for (int npass=0; npass<extrapasses; npass++) {
 
       // flags index values
-      if (npass != 0) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+      for (int idx=0; idx<wavesOnMapSize; idx++) {
         // if splat count > 4, reduce to value, and mark as splatted
-        for (int idx=0; idx<wavesOnMapSize; idx++) {
-          if (wavesc[idx] >= 4 && wavesc[idx] != SPLATTED) {
-            waves[idx] /= (float)wavesc[idx];
-            wavesc[idx] = SPLATTED;
-          }
+        if (npass != 0 && wavesc[idx] >= 4 && wavesc[idx] != SPLATTED) {
+          waves[idx] /= (float)wavesc[idx];
+          wavesc[idx] = SPLATTED;
         }
+        splatted[idx] = (wavesc[idx] == SPLATTED);
       }
 
-      int idx = 0;
-      for (int py=0; py<wavesOnMapHeight; py++)
-        for (int px=0; px<wavesOnMapWidth; px++,idx++){
-          // if splatted::
-          if  (wavesc[idx] == SPLATTED) {
-
-            // splat to the left, top, bottom, right
-            if (px>0) {
-              // left
-              if (wavesc[idx-1]!=SPLATTED) {
-                wavesc[idx-1]+=8;
-                waves [idx-1]+=(waves[idx]*8.0);
-              }
-              // bottom left
-              if (py>0 && wavesc[idx-wavesOnMapWidth-1]!=SPLATTED) {
-                wavesc[idx-wavesOnMapWidth-1]+=4;
-                waves [idx-wavesOnMapWidth-1]+=(waves[idx]*4.0);
-              }
-              // top left
-              if (py<wavesOnMapHeight-1 && wavesc[idx+wavesOnMapWidth-1]!=SPLATTED) {
-                wavesc[idx+wavesOnMapWidth-1]+=4;
-                waves [idx+wavesOnMapWidth-1]+=(waves[idx]*4.0);
-              }
+      // pixels not splatted yet gather from their splatted neighbors: left, bottom, right, top
+      // with weight 8, diagonals with weight 4 and second left, bottom, right, top with weight 1.
+      // neighbors get added in index order, the order in which they splatted to their neighbors
+      // when traversing the map (splatted pixels are only read, so rows are independent).
+      // pixels of inactive tiles stay as they are
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+      for (int py=0; py<H; py++) {
+        const int fy = py % FH;
+        const unsigned char *tilerow = (tiles != NULL) ? tiles + (py/wavetilesize)*ntilesx : NULL;
+        int idx = py*W;
+        for (int px=0; px<W; px++,idx++){
+          if (splatted[idx]) continue;
+          if (tilerow != NULL && ! tilerow[px/wavetilesize]) continue;
+
+          if (cubedsphere && (px<2 || px>=W-2 || fy<2 || fy>=FH-2)) {
+            for (int k=0; k<12; k++) {
+              int nidx = cubeNeighbor(idx,px,fy,passneighbors[k][0],passneighbors[k][1]);
+              if (nidx < 0 || ! splatted[nidx]) continue;
+              wavesc[idx]+=passneighbors[k][2];
+              if (passneighbors[k][2] == 1)
+                waves [idx]+=waves[nidx];
+              else
+                waves [idx]+=(waves[nidx]*(double)passneighbors[k][2]);
             }
+            continue;
+          }
 
-            // bottom
-            if (py>0 && wavesc[idx-wavesOnMapWidth]!=SPLATTED) {
-              wavesc[idx-wavesOnMapWidth]+=8;
-              waves [idx-wavesOnMapWidth]+=(waves[idx]*8.0);
+          if (fy>1 && splatted[idx-W-W]) {
+            wavesc[idx]++;
+            waves [idx]+=waves[idx-W-W];
+          }
+          if (fy>0) {
+            if (px>0 && splatted[idx-W-1]) {
+              wavesc[idx]+=4;
+              waves [idx]+=(waves[idx-W-1]*4.0);
             }
-
-            if (px<wavesOnMapWidth-1) {
-              // right
-              if (wavesc[idx+1]!=SPLATTED) {
-                wavesc[idx+1]+=8;
-                waves [idx+1]+=(waves[idx]*8.0);
-              }
-              // bottom right
-              if (py>0 && wavesc[idx-wavesOnMapWidth+1]!=SPLATTED) {
-                wavesc[idx-wavesOnMapWidth+1]+=4;
-                waves [idx-wavesOnMapWidth+1]+=(waves[idx]*4.0);
-              }
-              // top right
-              if (py<wavesOnMapHeight-1 && wavesc[idx+wavesOnMapWidth+1]!=SPLATTED) {
-                wavesc[idx+wavesOnMapWidth+1]+=4;
-                waves [idx+wavesOnMapWidth+1]+=(waves[idx]*4.0);
-              }
+            if (splatted[idx-W]) {
+              wavesc[idx]+=8;
+              waves [idx]+=(waves[idx-W]*8.0);
             }
-
-            // top
-            if (py<wavesOnMapHeight-1 && wavesc[idx+wavesOnMapWidth]!=SPLATTED) {
-              wavesc[idx+wavesOnMapWidth]+=8;
-              waves [idx+wavesOnMapWidth]+=(waves[idx]*8.0);
+            if (px<W-1 && splatted[idx-W+1]) {
+              wavesc[idx]+=4;
+              waves [idx]+=(waves[idx-W+1]*4.0);
             }
-
-            // +2 left
-            if (px>1 && wavesc[idx-2]!=SPLATTED) {
-              wavesc[idx-2]++;
-              waves [idx-2]+=waves[idx];
-            }
-            // +2 bottom
-            if (py>1 && wavesc[idx-wavesOnMapWidth-wavesOnMapWidth]!=SPLATTED) {
-              wavesc[idx-wavesOnMapWidth-wavesOnMapWidth]++;
-              waves [idx-wavesOnMapWidth-wavesOnMapWidth]+=waves[idx];
+          }
+          if (px>1 && splatted[idx-2]) {
+            wavesc[idx]++;
+            waves [idx]+=waves[idx-2];
+          }
+          if (px>0 && splatted[idx-1]) {
+            wavesc[idx]+=8;
+            waves [idx]+=(waves[idx-1]*8.0);
+          }
+          if (px<W-1 && splatted[idx+1]) {
+            wavesc[idx]+=8;
+            waves [idx]+=(waves[idx+1]*8.0);
+          }
+          if (px<W-2 && splatted[idx+2]) {
+            wavesc[idx]++;
+            waves [idx]+=waves[idx+2];
+          }
+          if (fy<FH-1) {
+            if (px>0 && splatted[idx+W-1]) {
+              wavesc[idx]+=4;
+              waves [idx]+=(waves[idx+W-1]*4.0);
             }
-            // +2 right
-            if (px<wavesOnMapWidth-2 && wavesc[idx+2]!=SPLATTED) {
-              wavesc[idx+2]++;
-              waves [idx+2]+=waves[idx];
+            if (splatted[idx+W]) {
+              wavesc[idx]+=8;
+              waves [idx]+=(waves[idx+W]*8.0);
             }
-            // +2 top
-            if (py<wavesOnMapHeight-2 && wavesc[idx+wavesOnMapWidth+wavesOnMapWidth]!=SPLATTED) {
-              wavesc[idx+wavesOnMapWidth+wavesOnMapWidth]++;
-              waves [idx+wavesOnMapWidth+wavesOnMapWidth]+=waves[idx];
+            if (px<W-1 && splatted[idx+W+1]) {
+              wavesc[idx]+=4;
+              waves [idx]+=(waves[idx+W+1]*4.0);
             }
           }
-        } // for
+          if (fy<FH-2 && splatted[idx+W+W]) {
+            wavesc[idx]++;
+            waves [idx]+=waves[idx+W+W];
+          }
+        }
+      } // py
     } // for npass
+
+    free(splatted);
   } // extrapasses
 
   // remove SPLATTED flags, and set as splat count = 1
   for (int idx=0; idx<wavesOnMapSize; idx++) if (wavesc[idx]==SPLATTED) wavesc[idx]=1;
+  if (timing) t = SplatTiming::lap(timing->diffuse,t);
 
 
   /* -----------------------------------------------------------------------------------------------
@@ -670,8 +1277,18 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
    // line filling  - smooths out holes
 
    ----------------------------------------------------------------------------------------------- */
-  if (doholefillingsweep){
-    for (;doholefillingsweep;doholefillingsweep--) {
+  if (holefillingsweeps){
+    const unsigned int maxvaluelife=1024;
+    const int W = wavesOnMapWidth;
+    const int H = wavesOnMapHeight;
+    const int BLOCK = 64;
+
+    // the four sweeps only add to pixels which are not splatted, and take their values from splatted
+    // pixels. rows (and columns, or rings of a family) of a sweep are therefore independent of each other
+    for (int nsweep=0; nsweep<holefillingsweeps; nsweep++) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
       for (int idx=0; idx<wavesOnMapSize; idx++) {
         if (wavesc[idx]) {
           if (wavesc[idx]<0) wavesc[idx]=-wavesc[idx];
@@ -680,83 +1297,737 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
         }
       }
 
-      const unsigned int maxvaluelife=1024;
-      unsigned int valuelife;
-      float value = 0.0f;
-
-      for (int py=0; py<wavesOnMapHeight; py++) {
-        valuelife=0;
-        int idx=py*wavesOnMapWidth;
-        for (int px=0; px<wavesOnMapWidth; px++,idx++) {
-          if (wavesc[idx]==SPLATTED) {
-            value=waves[idx];
-            valuelife=maxvaluelife;
-          } else {
-            if (valuelife) {
-              waves[idx]+=((float)valuelife*value);
-              wavesc[idx]+=valuelife;
-              valuelife--;
+      if (cubedsphere) {
+        // rings around the cubed sphere, both ways, one family of rings after the other. a sweep
+        // starts at a splatted texel of its ring and goes once around
+        for (int family=0; family<3; family++) {
+          const int s = cuberingaxis[family];
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+          for (int c=0; c<W; c++) {
+            std::vector<int> ring(4*W);
+            int i = (s == 1) ? 0 : c;
+            int j = (s == 1) ? c : 0;
+            int di = (s == 1) ? 1 : 0;
+            int dj = (s == 1) ? 0 : 1;
+            int idx = (cuberingface[family]*W + j)*W + i;
+            int first = -1;
+            for (int m=0; m<4*W; m++) {
+              ring[m] = idx;
+              if (first < 0 && wavesc[idx]==SPLATTED) first = m;
+              cubeStep(idx,i,j,di,dj);
+            }
+            if (first < 0) continue;
+
+            for (int dir=1; dir>=-1; dir-=2) {
+              unsigned int valuelife=0;
+              T value = T();
+              for (int m=1; m<=4*W; m++) {
+                idx = ring[(first + dir*m + 4*W) % (4*W)];
+                if (tiles != NULL && ! tiles[waveTile(idx)]) {
+                  valuelife=0;
+                  continue;
+                }
+                if (wavesc[idx]==SPLATTED) {
+                  value=waves[idx];
+                  valuelife=maxvaluelife;
+                } else {
+                  if (valuelife) {
+                    waves[idx]+=((float)valuelife*value);
+                    wavesc[idx]+=valuelife;
+                    valuelife--;
+                  }
+                }
+              }
             }
           }
         }
-      }
+      } else {
+        // rows, left to right and right to left
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+        for (int py=0; py<H; py++) {
+          const unsigned char *tilerow = (tiles != NULL) ? tiles + (py/wavetilesize)*ntilesx : NULL;
+          unsigned int valuelife=0;
+          T value = T();
+          int idx=py*W;
+          for (int px=0; px<W; px++,idx++) {
+            if (tilerow != NULL && ! tilerow[px/wavetilesize]) {
+              valuelife=0;
+              continue;
+            }
+            if (wavesc[idx]==SPLATTED) {
+              value=waves[idx];
+              valuelife=maxvaluelife;
+            } else {
+              if (valuelife) {
+                waves[idx]+=((float)valuelife*value);
+                wavesc[idx]+=valuelife;
+                valuelife--;
+              }
+            }
+          }
 
-      for (int py=0; py<wavesOnMapHeight; py++) {
-        valuelife=0;
-        int idx=(py+1)*wavesOnMapWidth-1;
-        for (int px=wavesOnMapWidth-1; px>=0; px--,idx--) {
-          if (wavesc[idx]==SPLATTED) {
-            value=waves[idx];
-            valuelife=maxvaluelife;
-          } else {
-            if (valuelife) {
-              waves[idx]+=((float)valuelife*value);
-              wavesc[idx]+=valuelife;
-              valuelife--;
+          valuelife=0;
+          idx=(py+1)*W-1;
+          for (int px=W-1; px>=0; px--,idx--) {
+            if (tilerow != NULL && ! tilerow[px/wavetilesize]) {
+              valuelife=0;
+              continue;
+            }
+            if (wavesc[idx]==SPLATTED) {
+              value=waves[idx];
+              valuelife=maxvaluelife;
+            } else {
+              if (valuelife) {
+                waves[idx]+=((float)valuelife*value);
+                wavesc[idx]+=valuelife;
+                valuelife--;
+              }
             }
           }
         }
-      }
 
-      for (int px=0; px<wavesOnMapWidth; px++) {
-        valuelife=0;
-        for (int py=0; py<wavesOnMapHeight; py++) {
-          int idx=py*wavesOnMapWidth+px;
-          if (wavesc[idx]==SPLATTED) {
-            value=waves[idx];
-            valuelife=maxvaluelife;
-          } else {
-            if (valuelife) {
-              waves[idx]+=((float)valuelife*value);
-              wavesc[idx]+=valuelife;
-              valuelife--;
+        // columns, bottom to top and top to bottom (traversed row by row for blocks of columns)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+        for (int bx=0; bx<W; bx+=BLOCK) {
+          const int nx = std::min(BLOCK,W-bx);
+          unsigned int valuelife[BLOCK];
+          T value[BLOCK];
+
+          for (int i=0; i<nx; i++) valuelife[i]=0;
+          for (int py=0; py<H; py++) {
+            const unsigned char *tilerow = (tiles != NULL) ? tiles + (py/wavetilesize)*ntilesx : NULL;
+            int idx=py*W+bx;
+            for (int i=0; i<nx; i++,idx++) {
+              if (tilerow != NULL && ! tilerow[(bx+i)/wavetilesize]) {
+                valuelife[i]=0;
+                continue;
+              }
+              if (wavesc[idx]==SPLATTED) {
+                value[i]=waves[idx];
+                valuelife[i]=maxvaluelife;
+              } else {
+                if (valuelife[i]) {
+                  waves[idx]+=((float)valuelife[i]*value[i]);
+                  wavesc[idx]+=valuelife[i];
+                  valuelife[i]--;
+                }
+              }
             }
           }
-        }
-      }
 
-      for (int px=0; px<wavesOnMapWidth; px++) {
-        valuelife=0;
-        for (int py=wavesOnMapHeight-1; py>=0; py--) {
-          int idx=py*wavesOnMapWidth+px;
-          if (wavesc[idx]==SPLATTED) {
-            value=waves[idx];
-            valuelife=maxvaluelife;
-          } else {
-            if (valuelife) {
-              waves[idx]+=((float)valuelife*value);
-              wavesc[idx]+=valuelife;
-              valuelife--;
+          for (int i=0; i<nx; i++) valuelife[i]=0;
+          for (int py=H-1; py>=0; py--) {
+            const unsigned char *tilerow = (tiles != NULL) ? tiles + (py/wavetilesize)*ntilesx : NULL;
+            int idx=py*W+bx;
+            for (int i=0; i<nx; i++,idx++) {
+              if (tilerow != NULL && ! tilerow[(bx+i)/wavetilesize]) {
+                valuelife[i]=0;
+                continue;
+              }
+              if (wavesc[idx]==SPLATTED) {
+                value[i]=waves[idx];
+                valuelife[i]=maxvaluelife;
+              } else {
+                if (valuelife[i]) {
+                  waves[idx]+=((float)valuelife[i]*value[i]);
+                  wavesc[idx]+=valuelife[i];
+                  valuelife[i]--;
+                }
+              }
             }
           }
         }
       }
 
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
       for (int idx=0; idx<wavesOnMapSize; idx++) {
         if (wavesc[idx]==SPLATTED) wavesc[idx]=1;
       }
     }
   }
+  if (timing) SplatTiming::lap(timing->holefill,t);
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// derives the splat operator by splatting symbolic values,
+// or reads it from the cache file next to the coordinates file
+
+bool SplatContext::initSplatOperator(bool verbose) {
+  TRACE("splatToImage: initSplatOperator")
+
+  // checks if anything to do
+  if (! use_wavefield || ! splatoperator) return true;
+
+  const char *source = (datacontainer != NULL) ? datacontainer : coordsfile;
+
+  SplatOperatorKey key;
+  memset(&key,0,sizeof(key));
+  key.npoints = ncoords;
+  key.width = wavesOnMapWidth;
+  key.height = wavesOnMapHeight;
+  key.splatkernel = splatkernel ? 1 : 0;
+  key.kernelradiusx = key.splatkernel ? kernelRadiusX : 0;
+  key.kernelradiusy = key.splatkernel ? kernelRadiusY : 0;
+  key.extrapasses = extrapasses;
+  key.holefillingsweeps = holefillingsweeps;
+  key.cubedsphere = cubedsphere ? 2 : 0;   // 2: splatting across face edges (1 in older caches)
+  splatOperatorSource(source,key);
+
+  char cachefilename[512];
+  snprintf(cachefilename,sizeof(cachefilename),"%s.splatop",source);
+
+  if (splatoperatorcache && readSplatOperator(cachefilename,key,splatop)) {
+    std::cerr << "splat operator: " << splatop.nnz << " entries, read from " << cachefilename << std::endl;
+    return true;
+  }
+
+  // splats symbolic values, each point with weight 1
+  std::vector<SplatRow> values(ncoords);
+  for (int idx=0; idx<ncoords; idx++) values[idx] = SplatRow::unit(idx);
+
+  std::vector<SplatRow> rows(wavesOnMapSize);
+  short *counts = (short *)malloc(sizeof(short)*wavesOnMapSize);
+  if (counts == NULL) {
+    std::cerr << "Error. could not allocate splat counts. Exiting." << std::endl;
+    return false;
+  }
+
+  splatWaves(&values[0],&rows[0],counts);
+  std::vector<SplatRow>().swap(values);
+
+  // compressed sparse rows
+  int64_t nnz = 0;
+  for (int idx=0; idx<wavesOnMapSize; idx++) {
+    rows[idx].compact();
+    for (size_t k=0; k<rows[idx].terms.size(); k++) if (rows[idx].terms[k].weight != 0.0) nnz++;
+  }
+
+  if (! allocateSplatOperator(splatop,wavesOnMapSize,nnz)) {
+    free(counts);
+    return false;
+  }
+  splatop.key = key;
+
+  int64_t n = 0;
+  for (int idx=0; idx<wavesOnMapSize; idx++) {
+    splatop.rows[idx] = n;
+    for (size_t k=0; k<rows[idx].terms.size(); k++) {
+      if (rows[idx].terms[k].weight == 0.0) continue;
+      splatop.cols[n] = rows[idx].terms[k].point;
+      splatop.weights[n] = (float)rows[idx].terms[k].weight;
+      n++;
+    }
+    std::vector<SplatTerm>().swap(rows[idx].terms);
+  }
+  splatop.rows[wavesOnMapSize] = n;
+  memcpy(splatop.counts,counts,sizeof(short)*wavesOnMapSize);
+  free(counts);
+
+  std::cerr << "splat operator: " << nnz << " entries" << std::endl;
+  if (verbose) std::cerr << "  entries per point: " << (double)nnz/(double)(ncoords > 0 ? ncoords : 1) << std::endl;
+
+  if (splatoperatorcache && writeSplatOperator(cachefilename,splatop))
+    std::cerr << "splat operator: written to " << cachefilename << std::endl;
+
+  return true;
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+ //               RASTER OPERATOR
+
+ // with element connectivity, the wave map gets filled by rasterizing the element quads instead of
+ // splatting the points: each pixel center covered by a quad takes the bilinear interpolation of
+ // the quad corner values. pixel corners and weights form an operator with up to 4 entries per
+ // pixel, which is applied to the frames like the splat operator.
+
+ ----------------------------------------------------------------------------------------------- */
+
+// longitude difference in pixels, wrapped to -width/2 .. width/2
+
+static inline double wrapPixelsX(double dx, double width){
+  if (dx > 0.5*width) return dx - width;
+  if (dx < -0.5*width) return dx + width;
+  return dx;
+}
+
+// inverse bilinear mapping: parameters (u,v) of pixel location (x,y) within quad p0,p1,p2,p3
+// with p(u,v) = p0 + u (p1-p0) + v (p3-p0) + u v (p0-p1+p2-p3)
+
+static void invBilinear(const double* px, const double* py, double x, double y, double &u, double &v){
+  const double ex = px[1]-px[0], ey = py[1]-py[0];
+  const double fx = px[3]-px[0], fy = py[3]-py[0];
+  const double gx = px[0]-px[1]+px[2]-px[3], gy = py[0]-py[1]+py[2]-py[3];
+  const double hx = x-px[0], hy = y-py[0];
+
+  const double k2 = gx*fy - gy*fx;
+  const double k1 = ex*fy - ey*fx + hx*gy - hy*gx;
+  const double k0 = hx*ey - hy*ex;
+
+  double vs[2];
+  int nv = 0;
+  if (fabs(k2) <= 1.e-6*fabs(ex*fy - ey*fx)) {
+    // parallelogram
+    vs[nv++] = (k1 != 0.0) ? -k0/k1 : 0.0;
+  } else {
+    double w = k1*k1 - 4.0*k0*k2;
+    w = (w > 0.0) ? sqrt(w) : 0.0;
+    vs[nv++] = (-k1 - w)/(2.0*k2);
+    vs[nv++] = (-k1 + w)/(2.0*k2);
+  }
+
+  // takes the root closest to the unit square
+  double mindist = 1.e30;
+  for (int n=0; n<nv; n++) {
+    double dx = ex + gx*vs[n];
+    double dy = ey + gy*vs[n];
+    double un;
+    if (fabs(dx) >= fabs(dy)) un = (dx != 0.0) ? (hx - fx*vs[n])/dx : 0.5;
+    else un = (hy - fy*vs[n])/dy;
+
+    double dist = 0.0;
+    if (un < 0.0) dist -= un;
+    if (un > 1.0) dist += un-1.0;
+    if (vs[n] < 0.0) dist -= vs[n];
+    if (vs[n] > 1.0) dist += vs[n]-1.0;
+    if (dist < mindist) {
+      mindist = dist;
+      u = un;
+      v = vs[n];
+    }
+  }
+
+  if (!(u >= 0.0)) u = 0.0;
+  if (!(v >= 0.0)) v = 0.0;
+  if (u > 1.0) u = 1.0;
+  if (v > 1.0) v = 1.0;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// scanline rasterization of a quad given in (unwrapped) pixel locations,
+// sets corners and bilinear weights of all pixels with their center inside the quad
+
+void SplatContext::rasterQuad(const double* px, const double* py, const int* corners,
+                              int* pixelcorners, float* pixelweights) const {
+
+  double ymin = py[0], ymax = py[0];
+  for (int k=1; k<4; k++) {
+    if (py[k] < ymin) ymin = py[k];
+    if (py[k] > ymax) ymax = py[k];
+  }
+  int row0 = (int)ceil(ymin-0.5);
+  int row1 = (int)floor(ymax-0.5);
+  if (row0 < 0) row0 = 0;
+  if (row1 > wavesOnMapHeight-1) row1 = wavesOnMapHeight-1;
+
+  for (int row=row0; row<=row1; row++) {
+    const double y = row+0.5;
+
+    // span of the scanline through the quad edges
+    double xl = 1.e30, xr = -1.e30;
+    for (int k=0; k<4; k++) {
+      int k1 = (k+1)%4;
+      if ((py[k] <= y) == (py[k1] <= y)) continue;
+      double x = px[k] + (y-py[k])/(py[k1]-py[k])*(px[k1]-px[k]);
+      if (x < xl) xl = x;
+      if (x > xr) xr = x;
+    }
+    if (xl > xr) continue;
+
+    int col0 = (int)ceil(xl-0.5);
+    int col1 = (int)floor(xr-0.5);
+    for (int col=col0; col<=col1; col++) {
+      double u = 0.5, v = 0.5;
+      invBilinear(px,py,col+0.5,y,u,v);
+
+      // wraps at the dateline
+      int posx = col % wavesOnMapWidth;
+      if (posx < 0) posx += wavesOnMapWidth;
+      int idx = posx + wavesOnMapWidth*row;
+
+      for (int k=0; k<4; k++) pixelcorners[4*idx+k] = corners[k];
+      pixelweights[4*idx  ] = (float)((1.0-u)*(1.0-v));
+      pixelweights[4*idx+1] = (float)(u*(1.0-v));
+      pixelweights[4*idx+2] = (float)(u*v);
+      pixelweights[4*idx+3] = (float)((1.0-u)*v);
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// rasterizes the element quads given in connectivityfile
+
+bool SplatContext::initRasterOperator(bool verbose) {
+  TRACE("splatToImage: initRasterOperator")
+
+  int nquads = 0;
+  int *quads = readWaveQuads(connectivityfile,ncoords,nquads);
+  if (quads == NULL) return false;
+
+  int   *pixelcorners = (int *)malloc(sizeof(int)*4*wavesOnMapSize);
+  float *pixelweights = (float *)malloc(sizeof(float)*4*wavesOnMapSize);
+  if (pixelcorners == NULL || pixelweights == NULL) {
+    std::cerr << "Error. could not allocate raster table. Exiting." << std::endl;
+    free(quads);
+    return false;
+  }
+  for (int idx=0; idx<wavesOnMapSize; idx++) pixelcorners[4*idx] = -1;
+
+  const double width  = wavesOnMapWidth;
+  const double height = wavesOnMapHeight;
+
+  // quads at the poles, filled in after all others
+  std::vector<int> polarquads;
+
+  for (int pass=0; pass<2; pass++) {
+    int n = (pass == 0) ? nquads : (int)polarquads.size();
+
+    for (int nq=0; nq<n; nq++) {
+      int q = (pass == 0) ? nq : polarquads[nq];
+
+      int    corners[4];
+      double px[4], py[4];
+      bool   atpole[4];
+      int    ref = -1;
+      for (int k=0; k<4; k++) {
+        corners[k] = quads[4*q+k];
+        px[k] = width *(coords[2*corners[k]  ]+180.0)/360.0;
+        py[k] = height*(90.0-coords[2*corners[k]+1])/180.0;
+        atpole[k] = (py[k] <= 0.0 || py[k] >= height);
+        if (ref < 0 && ! atpole[k]) ref = k;
+      }
+
+      // longitudes of quads around a pole wind once around the globe
+      double winding = 0.0;
+      for (int k=0; k<4; k++) winding += wrapPixelsX(px[(k+1)%4]-px[k],width);
+      bool aroundpole = fabs(winding) > 0.5*width;
+      bool polar = aroundpole || atpole[0] || atpole[1] || atpole[2] || atpole[3];
+
+      // unwraps quads across the dateline (corners at a pole have no longitude)
+      if (ref < 0) ref = 0;
+      for (int k=0; k<4; k++) px[k] = px[ref] + wrapPixelsX(px[k]-px[ref],width);
+
+      if (pass == 0) {
+        if (polar) polarquads.push_back(q);
+        if (aroundpole) continue;
+
+        // corners given in grid order (0,1,3,2) instead of around the quad
+        double a1 = (px[1]-px[0])*(py[2]-py[0]) - (py[1]-py[0])*(px[2]-px[0]);
+        double a2 = (px[2]-px[0])*(py[3]-py[0]) - (py[2]-py[0])*(px[3]-px[0]);
+        if (a1*a2 < 0.0) {
+          std::swap(corners[2],corners[3]);
+          std::swap(px[2],px[3]);
+          std::swap(py[2],py[3]);
+        }
+
+        rasterQuad(px,py,corners,pixelcorners,pixelweights);
+        continue;
+      }
+
+      // pole cap: pixels between the pole and the quad, which are not covered by any other quad,
+      // take the average of the quad corners
+      bool north = (py[0]+py[1]+py[2]+py[3]) < 2.0*height;
+      double ylimit = py[0];
+      double xmin = 1.e30, xmax = -1.e30;
+      for (int k=0; k<4; k++) {
+        if (north && py[k] > ylimit) ylimit = py[k];
+        if (! north && py[k] < ylimit) ylimit = py[k];
+        if (atpole[k]) continue;
+        if (px[k] < xmin) xmin = px[k];
+        if (px[k] > xmax) xmax = px[k];
+      }
+
+      int row0 = north ? 0 : (int)ceil(ylimit-0.5);
+      int row1 = north ? (int)floor(ylimit-0.5) : wavesOnMapHeight-1;
+      int col0 = 0;
+      int col1 = wavesOnMapWidth-1;
+      if (! aroundpole) {
+        if (xmin > xmax) continue;
+        col0 = (int)ceil(xmin-0.5);
+        col1 = (int)floor(xmax-0.5);
+      }
+      if (row0 < 0) row0 = 0;
+      if (row1 > wavesOnMapHeight-1) row1 = wavesOnMapHeight-1;
+
+      for (int row=row0; row<=row1; row++) {
+        for (int col=col0; col<=col1; col++) {
+          int posx = col % wavesOnMapWidth;
+          if (posx < 0) posx += wavesOnMapWidth;
+          int idx = posx + wavesOnMapWidth*row;
+          if (pixelcorners[4*idx] >= 0) continue;
+
+          for (int k=0; k<4; k++) {
+            pixelcorners[4*idx+k] = corners[k];
+            pixelweights[4*idx+k] = 0.25f;
+          }
+        }
+      }
+    }
+  }
+  free(quads);
+
+  // compressed sparse rows
+  int64_t nnz = 0;
+  int ncovered = 0;
+  for (int idx=0; idx<wavesOnMapSize; idx++) {
+    if (pixelcorners[4*idx] < 0) continue;
+    ncovered++;
+    for (int k=0; k<4; k++) if (pixelweights[4*idx+k] != 0.0f) nnz++;
+  }
+
+  if (! allocateSplatOperator(splatop,wavesOnMapSize,nnz)) {
+    free(pixelcorners);
+    free(pixelweights);
+    return false;
+  }
+  splatop.key.npoints = ncoords;
+  splatop.key.width = wavesOnMapWidth;
+  splatop.key.height = wavesOnMapHeight;
+
+  int64_t n = 0;
+  for (int idx=0; idx<wavesOnMapSize; idx++) {
+    splatop.rows[idx] = n;
+    splatop.counts[idx] = 0;
+    if (pixelcorners[4*idx] < 0) continue;
+    splatop.counts[idx] = 1;
+    for (int k=0; k<4; k++) {
+      if (pixelweights[4*idx+k] == 0.0f) continue;
+      splatop.cols[n] = pixelcorners[4*idx+k];
+      splatop.weights[n] = pixelweights[4*idx+k];
+      n++;
+    }
+  }
+  splatop.rows[wavesOnMapSize] = n;
+  free(pixelcorners);
+  free(pixelweights);
+
+  std::cerr << "element quads: " << nquads << " quads rasterized, " << polarquads.size() << " at poles" << std::endl;
+  if (verbose) std::cerr << "  covered pixels: " << ncovered << " of " << wavesOnMapSize << std::endl;
+
+  return true;
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+ //               ACTIVE REGION
+
+ // early frames are nonzero only around the epicenter. splatting skips the tiles of the wave map
+ // which no point above the threshold can reach through splat kernels and splat passes, and the
+ // renderer skips the wave blending of tiles without splatted values above the threshold.
+
+ ----------------------------------------------------------------------------------------------- */
+
+// marks tiles with points above threshold, extended by the reach of splat kernels and splat passes
+
+void SplatContext::initActiveRegion(const float* values, float threshold, unsigned char* tiles) const {
+  TRACE("splatToImage: initActiveRegion")
+
+  const int ntiles = ntilesx*ntilesy;
+  std::vector<unsigned char> active(ntiles,0);
+
+  for (int n=0; n<nscatter; n++) {
+    if (fabs(values[scatterpoint[n]]) > threshold) active[waveTile(scatterpixel[n])] = 1;
+  }
+
+  // reach in pixels: kernel radius and 2 pixels per splat pass, twice for the pixels these depend on
+  int kernelreachx = 0;
+  int kernelreachy = 0;
+  if (splatkernel) {
+    for (int nthkernel=0; nthkernel<nadaptivekernels; nthkernel++) {
+      kernelreachx = std::max(kernelreachx,adaptivekernelsRadiusX[nthkernel]);
+      kernelreachy = std::max(kernelreachy,adaptivekernelsRadiusY[nthkernel]);
+    }
+  }
+  const int reachx = (2*(kernelreachx+2*extrapasses)+wavetilesize-1)/wavetilesize + 1;
+  const int reachy = (2*(kernelreachy+2*extrapasses)+wavetilesize-1)/wavetilesize + 1;
+
+  // dilates along rows (around the dateline for the equirectangular map), then along columns
+  std::vector<unsigned char> rows(ntiles,0);
+  for (int ty=0; ty<ntilesy; ty++) {
+    for (int tx=0; tx<ntilesx; tx++) {
+      if (! active[ty*ntilesx+tx]) continue;
+      for (int k=-reachx; k<=reachx; k++) {
+        int x = tx+k;
+        if (cubedsphere) {
+          if (x < 0 || x >= ntilesx) continue;
+        } else {
+          x = (x % ntilesx + ntilesx) % ntilesx;
+        }
+        rows[ty*ntilesx+x] = 1;
+      }
+    }
+  }
+
+  memset(tiles,0,ntiles*sizeof(unsigned char));
+  for (int ty=0; ty<ntilesy; ty++) {
+    for (int tx=0; tx<ntilesx; tx++) {
+      if (! rows[ty*ntilesx+tx]) continue;
+      for (int y=std::max(ty-reachy,0); y<=std::min(ty+reachy,ntilesy-1); y++) tiles[y*ntilesx+tx] = 1;
+    }
+  }
+
+  // the flood fill of the polar rows carries values along whole rows, into the gaps of inactive
+  // tiles, and the line filling carries them on along the columns. once the active region reaches
+  // the polar rows, the whole map is active
+  if (! cubedsphere) {
+    for (int ty=0; ty<ntilesy; ty++) {
+      bool polar = false;
+      for (int kj=ty*wavetilesize; kj<std::min((ty+1)*wavetilesize,wavesOnMapHeight); kj++)
+        if (polarRow(kj)) polar = true;
+      if (! polar) continue;
+      for (int tx=0; tx<ntilesx; tx++) {
+        if (tiles[ty*ntilesx+tx]) {
+          memset(tiles,1,ntiles*sizeof(unsigned char));
+          return;
+        }
+      }
+    }
+  }
+
+  // the reach of active tiles at the face edges of the cubed sphere map continues on the adjacent faces
+  if (cubedsphere) {
+    const int n = wavesOnMapWidth;
+    const int reach = std::min(std::max(reachx,reachy)*wavetilesize,n);
+    std::vector<unsigned char> faces(tiles,tiles+ntiles);
+    for (int face=0; face<6; face++) {
+      for (int edge=0; edge<4; edge++) {
+        for (int c=0; c<n; c++) {
+          // edge texel, and step across the edge
+          int i = (edge == 0) ? 0 : ((edge == 1) ? n-1 : c);
+          int j = (edge == 2) ? 0 : ((edge == 3) ? n-1 : c);
+          int di = (edge == 0) ? -1 : ((edge == 1) ? 1 : 0);
+          int dj = (edge == 2) ? -1 : ((edge == 3) ? 1 : 0);
+          int idx = (face*n + j)*n + i;
+          if (! faces[waveTile(idx)]) continue;
+          for (int k=0; k<reach; k++) {
+            cubeStep(idx,i,j,di,dj);
+            tiles[waveTile(idx)] = 1;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// marks tiles of the wave map with splatted values above threshold
+
+void SplatContext::setActiveTiles(const float* waves, const short* wavesc, float threshold, unsigned char* tiles) const {
+  TRACE("splatToImage: setActiveTiles")
+
+  memset(tiles,0,ntilesx*ntilesy*sizeof(unsigned char));
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+  for (int ty=0; ty<ntilesy; ty++) {
+    unsigned char *tilerow = tiles + ty*ntilesx;
+    for (int py=ty*wavetilesize; py<std::min((ty+1)*wavetilesize,wavesOnMapHeight); py++) {
+      int idx = py*wavesOnMapWidth;
+      for (int px=0; px<wavesOnMapWidth; px++,idx++) {
+        if (wavesc[idx] != 0 && fabs(waves[idx]) > threshold*abs(wavesc[idx])) tilerow[px/wavetilesize] = 1;
+      }
+    }
+  }
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+ //               READ AND SPLAT WAVES
+
+ // for frame #nframe, into wave map waves,wavesc
+ // (frame data is read into wavedata, the value bounds of the frame are returned in minval,maxval)
+
+ ----------------------------------------------------------------------------------------------- */
+ // for (int nframe=frame_first; nframe<=frame_last; nframe+=frame_step)
+
+bool SplatContext::readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned char* wavest, const unsigned short* wavesd,
+                                     WaveData &wavedata, float &minval, float &maxval, bool verbose,
+                                     SplatTiming *timing) const {
+
+  TRACE("splatToImage: readAndSplatWaves")
+  // checks if anything to do
+  if (! use_wavefield){ return true; }
+
+  const double tstart = timing ? timingClock() : 0.0;
+  double t = tstart;
+
+  /* -----------------------------------------------------------------------------------------------
+    // reads wavefield file
+    ----------------------------------------------------------------------------------------------- */
+  if (datacontainer != NULL) {
+    // container frame
+    if (verbose) std::cerr<<"Processing frame " << nframe << " of " << datacontainer << std::endl;
+    if (! openWaveContainerFrame(wavecontainer,nframe,ncoords,wavedata)) return false;
+  } else {
+    char datafilename[512];
+    snprintf(datafilename,sizeof(datafilename),datafiletemplate,(nframe+datafileoffset)*datafilestep);
+    if (verbose) std::cerr<<"Processing datafile " << datafilename<<std::endl;
+
+    // maps data file
+    if (! openWaveData(datafilename,ncoords,wavedata)) return false;
+  }
+  const float *values = wavedata.values;
+
+  // min/max statistics
+  waveDataMinMax(values,ncoords,minval,maxval);
+  if (timing) t = SplatTiming::lap(timing->read,t);
+
+  // threshold of active region
+  const float activevalue = (float)(activethreshold*std::max(fabs(minval),fabs(maxval)));
+
+  //if (verbose)
+  fprintf(stderr,"  frames value bounds %e <--> %e\n",minval,maxval);
+
+  if (usesetbounds) {
+    fprintf(stderr,"  use bounds      : %e <--> %e\n",minvalbound,maxvalbound);
+    minval = minvalbound;
+    maxval = maxvalbound;
+  }
+
+  // used by default (see definitions on top of file)
+  if (simmetricbounds) {
+    if (minval < 0) minval=-minval;
+    if (maxval < 0) maxval=-maxval;
+    if (minval > maxval) maxval=minval;
+    minval = -maxval;
+    fprintf(stderr,"  symmetric bounds: %e <--> %e\n",minval,maxval);
+  }
+
+  if (verbose)
+  std::cerr<< "  colormap bounds: " << minval << " .. " << maxval << "   /" << maxval-minval << std::endl;
+
+  // splats wavefield values onto wave map
+  if (timing) t = timingClock();
+  if (splatoperator || connectivityfile != NULL) {
+    applySplatOperator(splatop,values,waves,wavesc);
+    if (timing) SplatTiming::lap(timing->accumulate,t);
+  } else {
+    // active region of frame (tile buffer gets reused for the active tiles of the wave map below)
+    const unsigned char *region = NULL;
+    if (activetiles && wavest != NULL) {
+      initActiveRegion(values,activevalue,wavest);
+      region = wavest;
+    }
+    if (timing) t = SplatTiming::lap(timing->accumulate,t);
+    splatWaves(values,waves,wavesc,region,timing);
+  }
+
+  if (timing) t = timingClock();
+  closeWaveData(wavedata);
+  if (timing) SplatTiming::lap(timing->read,t);
 
   /* -----------------------------------------------------------------------------------------------
 
@@ -764,7 +2035,7 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
 
    ----------------------------------------------------------------------------------------------- */
   if (docutoff) {
-    static int rangecutofframes = endcutoffframe-startcutoffframe;
+    int rangecutofframes = endcutoffframe-startcutoffframe;
     double attenuation = 1.0;
     if (nframe > startcutoffframe) {
        attenuation = 1.0;
@@ -780,6 +2051,25 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
     }
   }
 
+  // active tiles of wave map
+  if (wavest != NULL) {
+    if (activetiles) {
+      setActiveTiles(waves,wavesc,activevalue,wavest);
+      if (verbose) {
+        int nactive = 0;
+        for (int n=0; n<ntilesx*ntilesy; n++) if (wavest[n]) nactive++;
+        std::cerr << "  active tiles: " << nactive << " of " << ntilesx*ntilesy << std::endl;
+      }
+    } else {
+      memset(wavest,1,ntilesx*ntilesy*sizeof(unsigned char));
+    }
+  }
+
+  if (timing) {
+    timing->total = timingClock() - tstart;
+    timing->points = ncoords;
+  }
+
   return true;
 }
 
@@ -788,13 +2078,15 @@ bool readAndSplatWaves(int nframe, float* waves, short* wavesc, unsigned short*
 // writeSplattedWavesPPM routine
 
 /* ----------------------------------------------------------------------------------------------- */
-bool writeSplattedWavesPPM(int nframe, float* waves, short* wavesc) {
+bool SplatContext::writeSplattedWavesPPM(int nframe, const float* waves, const short* wavesc, float minval, float maxval) const {
 
   TRACE("splatToImage: writeSplattedWavesPPM")
   // checks if anything to do
   if (! use_wavefield){ return true; }
 
-  sprintf(wavesfilename,wavesfilenametemplate,nframe);
+  const char * wavesfilenametemplate = "frame.%06i.ppm";
+  char wavesfilename[80];
+  snprintf(wavesfilename,sizeof(wavesfilename),wavesfilenametemplate,nframe);
 
   FILE *fptr = fopen(wavesfilename,"wb");
   if (fptr == NULL) return false;
@@ -0,0 +1,396 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// timing.h
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <iterator>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+/* -----------------------------------------------------------------------------------------------
+
+timing
+
+ per-stage timing of the frame loop. stages run on the prefetch, the rendering and the output
+ thread, their times get recorded per image (frame number of the output file) under a lock.
+ per-pixel feature passes are summed per OpenMP thread (thus CPU seconds over all threads) and
+ added to the image after its pixel loop; all other stages are wall clock seconds.
+
+ the report lists the stages of each image (CSV, or JSON for a .json file name), a summary
+ with percentiles over all images gets printed at the end, together with the busy time of each
+ OpenMP thread in the pixel loops (time spent on render tiles, summed over all images).
+
+----------------------------------------------------------------------------------------------- */
+
+enum TimingStage {
+  // setup (once)
+  TIMING_LOADMAPS = 0,
+  TIMING_SPLATSETUP,
+  // splatting (read, scatter/accumulate, neighbor interpolation, hole filling; total)
+  TIMING_READ,
+  TIMING_ACCUMULATE,
+  TIMING_DIFFUSE,
+  TIMING_HOLEFILL,
+  TIMING_SPLAT,
+  // frame setup (includes waiting for the prefetched wavefield) and pixel loop
+  TIMING_SETUP,
+  TIMING_RENDER,
+  // pixel passes (summed over threads)
+  TIMING_PIXEL,
+  TIMING_BASELAYER,
+  TIMING_SURFACE,
+  TIMING_LINES,
+  TIMING_LIGHTS,
+  TIMING_SPECULAR,
+  TIMING_NIGHT,
+  TIMING_WAVES,
+  TIMING_CLOUDS,
+  TIMING_CONTOUR,
+  TIMING_BACKGLOW,
+  // output stage
+  TIMING_HALFIMAGE,
+  TIMING_ANNOTATE,
+  TIMING_WRITE,
+  // counters
+  TIMING_PIXELSONSPHERE,
+  TIMING_POINTSSPLATTED,
+  NTIMINGSTAGES
+};
+
+// first per-frame stage and first counter
+#define TIMING_FIRST_FRAMESTAGE TIMING_READ
+#define TIMING_FIRST_COUNTER    TIMING_PIXELSONSPHERE
+
+static const char *timingStageNames[NTIMINGSTAGES] = {
+  "loadmaps", "splatsetup",
+  "read", "accumulate", "diffuse", "holefill", "splat",
+  "setup", "render",
+  "pixel", "baselayer", "surface", "lines", "lights", "specular", "night", "waves", "clouds", "contour", "backglow",
+  "halfimage", "annotate", "write",
+  "pixels_on_sphere", "points_splatted"
+};
+
+// monotonic wall clock (in seconds)
+
+inline double timingClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec + 1.e-9*(double)ts.tv_nsec;
+}
+
+// splatting times of a wavefield frame (filled by SplatContext::readAndSplatWaves)
+
+struct SplatTiming {
+  double read;
+  double accumulate;
+  double diffuse;
+  double holefill;
+  double total;
+  double points;
+
+  SplatTiming() : read(0.0), accumulate(0.0), diffuse(0.0), holefill(0.0), total(0.0), points(0.0) {}
+
+  // adds time since t to stage, returns current time
+  static double lap(double &stage, double t) {
+    double now = timingClock();
+    stage += now - t;
+    return now;
+  }
+};
+
+class Timing {
+public:
+  Timing();
+
+  bool enabled;
+  const char *filename;
+
+  void add(int stage, double value, int frame_number=-1, int nframe=-1);
+  void addSplat(const SplatTiming &splat, int frame_number, int nframe);
+
+  // per-thread accumulation in pixel loop
+  void beginPixels();
+  void endPixels(int frame_number, int nframe);
+  inline void addThread(int stage, double value);
+  inline void addBusy(double value) { addThread(NTIMINGSTAGES,value); }
+
+  bool write(const char *filename) const;
+  void printSummary() const;
+
+private:
+  struct FrameTiming {
+    int nframe;
+    double values[NTIMINGSTAGES];
+  };
+
+  mutable std::mutex lock;
+  std::map<int,FrameTiming> frames;   // by frame number
+  double setup[NTIMINGSTAGES];
+
+  // per-thread sums, padded to separate cache lines
+  std::vector<double> threadvalues;
+  int threadstride;
+  double pixelstart;
+
+  // busy time of each thread over all pixel loops
+  std::vector<double> threadbusy;
+  double rendertotal;
+
+  // values of stage over all frames, sorted
+  std::vector<double> sortedValues(int stage) const;
+
+  // not copyable (owns its lock)
+  Timing(const Timing&);
+  Timing& operator=(const Timing&);
+};
+
+// times scope, adds to stage of frame when leaving it
+
+class ScopedTimer {
+public:
+  ScopedTimer(Timing &t, int s, int frame=-1, int n=-1) : timing(t), stage(s), frame_number(frame), nframe(n) {
+    start = timing.enabled ? timingClock() : 0.0;
+  }
+  ~ScopedTimer() {
+    if (timing.enabled) timing.add(stage,timingClock()-start,frame_number,nframe);
+  }
+
+private:
+  Timing &timing;
+  int stage;
+  int frame_number;
+  int nframe;
+  double start;
+};
+
+Timing::Timing() {
+  enabled = false;
+  filename = NULL;
+  threadstride = (NTIMINGSTAGES + 1 + 7) / 8 * 8;  // stages and busy time
+  pixelstart = 0.0;
+  rendertotal = 0.0;
+  for (int s=0; s<NTIMINGSTAGES; s++) setup[s] = 0.0;
+}
+
+// adds value to stage of frame (frame_number < 0 for setup stages)
+
+void Timing::add(int stage, double value, int frame_number, int nframe) {
+  if (! enabled) return;
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (frame_number < 0) {
+    setup[stage] += value;
+    return;
+  }
+
+  std::map<int,FrameTiming>::iterator it = frames.find(frame_number);
+  if (it == frames.end()) {
+    FrameTiming record;
+    memset(&record,0,sizeof(FrameTiming));
+    record.nframe = nframe;
+    it = frames.insert(std::make_pair(frame_number,record)).first;
+  }
+  it->second.values[stage] += value;
+}
+
+void Timing::addSplat(const SplatTiming &splat, int frame_number, int nframe) {
+  if (! enabled || splat.total <= 0.0) return;
+
+  add(TIMING_READ,splat.read,frame_number,nframe);
+  add(TIMING_ACCUMULATE,splat.accumulate,frame_number,nframe);
+  add(TIMING_DIFFUSE,splat.diffuse,frame_number,nframe);
+  add(TIMING_HOLEFILL,splat.holefill,frame_number,nframe);
+  add(TIMING_SPLAT,splat.total,frame_number,nframe);
+  add(TIMING_POINTSSPLATTED,splat.points,frame_number,nframe);
+}
+
+// clears per-thread sums before the pixel loop
+
+void Timing::beginPixels() {
+  if (! enabled) return;
+
+  int nthreads = 1;
+#if defined(_OPENMP)
+  nthreads = std::max(omp_get_max_threads(),omp_get_num_procs());
+#endif
+  threadvalues.assign((size_t)nthreads*threadstride,0.0);
+  pixelstart = timingClock();
+}
+
+inline void Timing::addThread(int stage, double value) {
+  int thread = 0;
+#if defined(_OPENMP)
+  thread = omp_get_thread_num();
+#endif
+  threadvalues[(size_t)thread*threadstride + stage] += value;
+}
+
+// adds per-thread sums and the pixel loop time to frame
+
+void Timing::endPixels(int frame_number, int nframe) {
+  if (! enabled) return;
+
+  double render = timingClock()-pixelstart;
+  add(TIMING_RENDER,render,frame_number,nframe);
+
+  size_t nthreads = threadvalues.size() / threadstride;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (threadbusy.size() < nthreads) threadbusy.resize(nthreads,0.0);
+    for (size_t n=0; n<nthreads; n++) threadbusy[n] += threadvalues[n*threadstride + NTIMINGSTAGES];
+    rendertotal += render;
+  }
+  for (int s=TIMING_PIXEL; s<=TIMING_BACKGLOW; s++) {
+    double sum = 0.0;
+    for (size_t n=0; n<nthreads; n++) sum += threadvalues[n*threadstride + s];
+    add(s,sum,frame_number,nframe);
+  }
+  double sum = 0.0;
+  for (size_t n=0; n<nthreads; n++) sum += threadvalues[n*threadstride + TIMING_PIXELSONSPHERE];
+  add(TIMING_PIXELSONSPHERE,sum,frame_number,nframe);
+}
+
+std::vector<double> Timing::sortedValues(int stage) const {
+  std::vector<double> values;
+  for (std::map<int,FrameTiming>::const_iterator it=frames.begin(); it!=frames.end(); ++it)
+    values.push_back(it->second.values[stage]);
+  std::sort(values.begin(),values.end());
+  return values;
+}
+
+// nearest-rank percentile of sorted values
+
+static double timingPercentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) return 0.0;
+  int rank = (int)ceil(p*(double)sorted.size());
+  if (rank < 1) rank = 1;
+  return sorted[rank-1];
+}
+
+// writes per-frame report, as JSON for file names ending in .json, CSV otherwise
+
+bool Timing::write(const char *name) const {
+  TRACE("timing: write")
+
+  std::lock_guard<std::mutex> guard(lock);
+
+  FILE *fp = fopen(name,"w");
+  if (fp == NULL) {
+    std::cerr << "Error. could not open timing report " << name << ". Exiting." << std::endl;
+    return false;
+  }
+
+  size_t len = strlen(name);
+  bool json = len > 5 && strcmp(name+len-5,".json") == 0;
+
+  if (json) {
+    fprintf(fp,"{\n  \"setup\": {");
+    for (int s=0; s<TIMING_FIRST_FRAMESTAGE; s++)
+      fprintf(fp,"%s\"%s\": %.6f",s > 0 ? ", " : "",timingStageNames[s],setup[s]);
+    fprintf(fp,"},\n  \"frames\": [\n");
+    for (std::map<int,FrameTiming>::const_iterator it=frames.begin(); it!=frames.end(); ++it) {
+      fprintf(fp,"    {\"frame\": %d, \"nframe\": %d",it->first,it->second.nframe);
+      for (int s=TIMING_FIRST_FRAMESTAGE; s<NTIMINGSTAGES; s++) {
+        if (s < TIMING_FIRST_COUNTER) fprintf(fp,", \"%s\": %.6f",timingStageNames[s],it->second.values[s]);
+        else fprintf(fp,", \"%s\": %.0f",timingStageNames[s],it->second.values[s]);
+      }
+      fprintf(fp,"}%s\n",std::next(it) != frames.end() ? "," : "");
+    }
+    fprintf(fp,"  ],\n  \"summary\": {\n");
+    for (int s=TIMING_FIRST_FRAMESTAGE; s<NTIMINGSTAGES; s++) {
+      std::vector<double> values = sortedValues(s);
+      double total = 0.0;
+      for (size_t n=0; n<values.size(); n++) total += values[n];
+      fprintf(fp,"    \"%s\": {\"total\": %.6f, \"mean\": %.6f, \"p50\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f}%s\n",
+              timingStageNames[s],total,values.empty() ? 0.0 : total/values.size(),
+              timingPercentile(values,0.5),timingPercentile(values,0.9),timingPercentile(values,0.99),
+              values.empty() ? 0.0 : values.back(),s < NTIMINGSTAGES-1 ? "," : "");
+    }
+    fprintf(fp,"  },\n  \"threadbusy\": [");
+    for (size_t n=0; n<threadbusy.size(); n++) fprintf(fp,"%s%.6f",n > 0 ? ", " : "",threadbusy[n]);
+    fprintf(fp,"]\n}\n");
+  } else {
+    fprintf(fp,"frame,nframe");
+    for (int s=TIMING_FIRST_FRAMESTAGE; s<NTIMINGSTAGES; s++) fprintf(fp,",%s",timingStageNames[s]);
+    fprintf(fp,"\n");
+    for (std::map<int,FrameTiming>::const_iterator it=frames.begin(); it!=frames.end(); ++it) {
+      fprintf(fp,"%d,%d",it->first,it->second.nframe);
+      for (int s=TIMING_FIRST_FRAMESTAGE; s<NTIMINGSTAGES; s++) {
+        if (s < TIMING_FIRST_COUNTER) fprintf(fp,",%.6f",it->second.values[s]);
+        else fprintf(fp,",%.0f",it->second.values[s]);
+      }
+      fprintf(fp,"\n");
+    }
+  }
+
+  bool ok = (ferror(fp) == 0);
+  if (fclose(fp) != 0) ok = false;
+  if (! ok) std::cerr << "Error. could not write timing report " << name << ". Exiting." << std::endl;
+  return ok;
+}
+
+// summary of stages over all frames (stages without any time are left out)
+
+void Timing::printSummary() const {
+  std::lock_guard<std::mutex> guard(lock);
+
+  fprintf(stderr,"\ntiming: %d images\n",(int)frames.size());
+  for (int s=0; s<TIMING_FIRST_FRAMESTAGE; s++)
+    if (setup[s] > 0.0) fprintf(stderr,"  %-16s %10.4f s\n",timingStageNames[s],setup[s]);
+
+  fprintf(stderr,"  %-16s %10s %10s %10s %10s %10s %10s\n","stage","total","mean","p50","p90","p99","max");
+  for (int s=TIMING_FIRST_FRAMESTAGE; s<NTIMINGSTAGES; s++) {
+    std::vector<double> values = sortedValues(s);
+    if (values.empty() || values.back() <= 0.0) continue;
+    double total = 0.0;
+    for (size_t n=0; n<values.size(); n++) total += values[n];
+    const char *format = (s < TIMING_FIRST_COUNTER) ? "  %-16s %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f\n"
+                                                    : "  %-16s %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n";
+    fprintf(stderr,format,timingStageNames[s],total,total/values.size(),
+            timingPercentile(values,0.5),timingPercentile(values,0.9),timingPercentile(values,0.99),values.back());
+  }
+  fprintf(stderr,"  (pixel passes in CPU seconds summed over threads, other stages in wall clock seconds)\n");
+
+  // load balance of pixel loops (threads without any tile are left out)
+  double busymax = 0.0, busysum = 0.0;
+  int nbusy = 0;
+  for (size_t n=0; n<threadbusy.size(); n++) {
+    if (threadbusy[n] <= 0.0) continue;
+    fprintf(stderr,"  thread %-9d %10.4f s busy\n",(int)n,threadbusy[n]);
+    busymax = std::max(busymax,threadbusy[n]);
+    busysum += threadbusy[n];
+    nbusy++;
+  }
+  if (nbusy > 0 && rendertotal > 0.0)
+    fprintf(stderr,"  threads busy %.1f %% of render time (mean), slowest thread %.1f %%\n",
+            100.0*busysum/nbusy/rendertotal,100.0*busymax/rendertotal);
+  fprintf(stderr,"\n");
+}
+
+#endif  // TIMING_H
@@ -0,0 +1,259 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// waveContainer.h
+#ifndef WAVECONTAINER_H
+#define WAVECONTAINER_H
+
+// wavefield container file (shared by genDataFromBin and renderOnSphere, C compatible)
+//
+// a single file holding the coordinates and all frames of an event:
+//
+//   header                     WaveContainerHeader
+//   coordinates                { (float) x, (float) y }*npts        (same as xy file)
+//   frame table                WaveContainerFrame*nframes
+//   frames                     frame payload*nframes                 (same as NNNNNN.v files for float32)
+//
+// sections and frames start at 64-byte aligned offsets. all values in native byte order.
+// frame k (0-based) corresponds to the frame file k written otherwise, i.e. to time step
+// (k + start + 1) * interval.
+//
+// frame encodings:
+//   float32  - raw float values
+//   float16  - WaveFrameHeader, then half floats of v/scale               (scale == max |v| of frame)
+//   log12    - WaveFrameHeader, then 12-bit codes, two codes in 3 bytes
+//              code = sign bit | 11-bit magnitude m, with m == 0 for |v| < scale*10^-range, otherwise
+//              |v| = scale * 10^(((m-1)/2046 - 1)*range)
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define WAVE_CONTAINER_MAGIC    "SHKWAVES"
+#define WAVE_CONTAINER_VERSION  1
+#define WAVE_CONTAINER_ALIGN    64
+
+// frame encodings
+#define WAVE_ENCODING_FLOAT32   0
+#define WAVE_ENCODING_FLOAT16   1
+#define WAVE_ENCODING_LOG12     2
+
+// dynamic range of log12 encoding (in decades below frame maximum)
+#define WAVE_LOG12_RANGE        6.0f
+
+typedef struct wave_container_header_tag {
+  char    magic[8];
+  int32_t version;
+  int32_t npts;
+  int32_t nframes;
+  int32_t interval;
+  int32_t start;
+  int32_t encoding;
+  int64_t coords_offset;
+  int64_t table_offset;
+  int64_t data_offset;
+  int64_t reserved[4];
+} WaveContainerHeader;
+
+typedef struct wave_container_frame_tag {
+  int64_t offset;
+  int64_t size;
+} WaveContainerFrame;
+
+// header of quantized frames
+typedef struct wave_frame_header_tag {
+  float   scale;
+  float   range;
+  int32_t reserved[2];
+} WaveFrameHeader;
+
+static inline int64_t waveContainerAlign(int64_t offset) {
+  return (offset + WAVE_CONTAINER_ALIGN - 1) / WAVE_CONTAINER_ALIGN * WAVE_CONTAINER_ALIGN;
+}
+
+// payload size of a frame with npts values
+static inline int64_t waveContainerFrameSize(int encoding, int npts) {
+  switch(encoding) {
+    case WAVE_ENCODING_FLOAT32: return (int64_t)npts*4;
+    case WAVE_ENCODING_FLOAT16: return sizeof(WaveFrameHeader) + (int64_t)npts*2;
+    case WAVE_ENCODING_LOG12:   return sizeof(WaveFrameHeader) + ((int64_t)npts+1)/2*3;
+    default: return -1;
+  }
+}
+
+// sets up header and section offsets, frames have fixed size and follow each other
+static inline void waveContainerLayout(WaveContainerHeader* header, int npts, int nframes,
+                                       int interval, int start, int encoding) {
+  int k;
+  for(k=0;k<8;k++) header->magic[k] = WAVE_CONTAINER_MAGIC[k];
+  header->version = WAVE_CONTAINER_VERSION;
+  header->npts = npts;
+  header->nframes = nframes;
+  header->interval = interval;
+  header->start = start;
+  header->encoding = encoding;
+  header->coords_offset = waveContainerAlign(sizeof(WaveContainerHeader));
+  header->table_offset = waveContainerAlign(header->coords_offset + (int64_t)npts*2*sizeof(float));
+  header->data_offset = waveContainerAlign(header->table_offset + (int64_t)nframes*sizeof(WaveContainerFrame));
+  for(k=0;k<4;k++) header->reserved[k] = 0;
+}
+
+static inline WaveContainerFrame waveContainerFrame(const WaveContainerHeader* header, int k) {
+  WaveContainerFrame frame;
+  frame.size = waveContainerFrameSize(header->encoding,header->npts);
+  frame.offset = header->data_offset + (int64_t)k*waveContainerAlign(frame.size);
+  return frame;
+}
+
+static inline const char* waveEncodingName(int encoding) {
+  switch(encoding) {
+    case WAVE_ENCODING_FLOAT32: return "float32";
+    case WAVE_ENCODING_FLOAT16: return "float16";
+    case WAVE_ENCODING_LOG12:   return "log12";
+    default: return "unknown";
+  }
+}
+
+static inline int waveEncodingFromName(const char* name) {
+  if(strcmp(name,"float32") == 0) return WAVE_ENCODING_FLOAT32;
+  if(strcmp(name,"float16") == 0) return WAVE_ENCODING_FLOAT16;
+  if(strcmp(name,"log12") == 0)   return WAVE_ENCODING_LOG12;
+  return -1;
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+frame encoding/decoding
+
+----------------------------------------------------------------------------------------------- */
+
+// half floats for values in [-1,1]: rescaling by 2^-112 moves the float exponent into the half
+// exponent range, so that the conversion becomes a shift (incl. subnormals, without branches)
+
+static inline uint16_t waveFloatToHalf(float f) {
+  uint32_t u;
+  memcpy(&u,&f,4);
+  uint32_t sign = (u >> 16) & 0x8000;
+  u &= 0x7fffffff;
+  float a;
+  memcpy(&a,&u,4);
+  a *= 0x1p-112f;
+  memcpy(&u,&a,4);
+  // round to nearest even
+  uint32_t h = (u + 0x0fff + ((u >> 13) & 1)) >> 13;
+  if(h > 0x7bff) h = 0x7bff;
+  return (uint16_t)(sign | h);
+}
+
+static inline float waveHalfToFloat(uint16_t h) {
+  uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+  float f;
+  memcpy(&f,&u,4);
+  f *= 0x1p112f;
+  memcpy(&u,&f,4);
+  u |= (uint32_t)(h & 0x8000) << 16;
+  memcpy(&f,&u,4);
+  return f;
+}
+
+static inline uint32_t waveLog12Code(float v, float scale, float range) {
+  float a = fabsf(v);
+  uint32_t sign = v < 0.0f ? 0x800 : 0;
+  float x = log10f(a/scale)/range + 1.0f;
+  if(!(x >= 0.0f)) return 0;
+  if(x > 1.0f) x = 1.0f;
+  return sign | (1 + (uint32_t)lrintf(x*2046.0f));
+}
+
+// fills lookup table of 4096 values for log12 codes
+static inline void waveLog12Table(float scale, float range, float* table) {
+  int m;
+  table[0] = 0.0f;
+  table[0x800] = 0.0f;
+  for(m=1;m<2048;m++) {
+    float v = scale * powf(10.0f,((float)(m-1)/2046.0f - 1.0f)*range);
+    table[m] = v;
+    table[0x800|m] = -v;
+  }
+}
+
+// encodes npts frame values into payload of size waveContainerFrameSize(encoding,npts)
+static inline void waveEncodeFrame(int encoding, const float* vs, int npts, unsigned char* payload) {
+  int i;
+  if(encoding == WAVE_ENCODING_FLOAT32) {
+    memcpy(payload,vs,(size_t)npts*4);
+    return;
+  }
+
+  WaveFrameHeader header;
+  float vmax = 0.0f;
+  for(i=0;i<npts;i++) vmax = fabsf(vs[i]) > vmax ? fabsf(vs[i]) : vmax;
+  header.scale = vmax > 0.0f ? vmax : 1.0f;
+  header.range = WAVE_LOG12_RANGE;
+  header.reserved[0] = header.reserved[1] = 0;
+  memcpy(payload,&header,sizeof(header));
+  unsigned char* p = payload + sizeof(header);
+
+  if(encoding == WAVE_ENCODING_FLOAT16) {
+    float inv = 1.0f/header.scale;
+    for(i=0;i<npts;i++) {
+      uint16_t h = waveFloatToHalf(vs[i]*inv);
+      memcpy(p+2*i,&h,2);
+    }
+  } else if(encoding == WAVE_ENCODING_LOG12) {
+    for(i=0;i<npts;i+=2) {
+      uint32_t c0 = waveLog12Code(vs[i],header.scale,header.range);
+      uint32_t c1 = i+1 < npts ? waveLog12Code(vs[i+1],header.scale,header.range) : 0;
+      p[0] = c0 & 0xff;
+      p[1] = (c0 >> 8) | ((c1 & 0xf) << 4);
+      p[2] = c1 >> 4;
+      p += 3;
+    }
+  }
+}
+
+// decodes npts frame values from payload
+static inline void waveDecodeFrame(int encoding, const unsigned char* payload, int npts, float* vs) {
+  int i;
+  if(encoding == WAVE_ENCODING_FLOAT32) {
+    memcpy(vs,payload,(size_t)npts*4);
+    return;
+  }
+
+  WaveFrameHeader header;
+  memcpy(&header,payload,sizeof(header));
+  const unsigned char* p = payload + sizeof(header);
+
+  if(encoding == WAVE_ENCODING_FLOAT16) {
+    const float scale = header.scale;
+    for(i=0;i<npts;i++) {
+      uint16_t h;
+      memcpy(&h,p+2*i,2);
+      vs[i] = waveHalfToFloat(h)*scale;
+    }
+  } else if(encoding == WAVE_ENCODING_LOG12) {
+    float table[4096];
+    waveLog12Table(header.scale,header.range,table);
+    int npairs = npts/2;
+    for(i=0;i<npairs;i++,p+=3) {
+      vs[2*i]   = table[p[0] | ((p[1] & 0xf) << 8)];
+      vs[2*i+1] = table[(p[1] >> 4) | (p[2] << 4)];
+    }
+    if(npts % 2) vs[npts-1] = table[p[0] | ((p[1] & 0xf) << 8)];
+  }
+}
+
+#endif  // WAVECONTAINER_H
@@ -0,0 +1,570 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// waveData.h
+#ifndef WAVEDATA_H
+#define WAVEDATA_H
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "waveContainer.h"
+
+// not available on all platforms (e.g. Mac OS)
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+/* -----------------------------------------------------------------------------------------------
+
+wavefield data frames
+
+ a frame file (e.g. 000012.v written by genDataFromBin) holds one raw float value per
+ coordinate point. the whole frame gets mapped into memory at once (or read with a single fread
+ if the file system does not support mmap), instead of reading the values point by point.
+
+ the shakemovie packets of SPECFEM (bin_movie_******.d.gz, bin_movie.xy.gz) can be read directly
+ as well. their decoder gets picked by the file extension:
+   *.gz, *.d, *.xy  - fortran records, gzip compressed or not
+                      data:   { (int) 4, (float) v, (int) 4 }
+                      coords: { (int) 8, (float) lon, (float) lat, (int) 8 }
+   anything else    - raw float values
+
+----------------------------------------------------------------------------------------------- */
+
+struct WaveData {
+  const float *values;    // frame values (ncoords entries)
+  int   npoints;
+
+  // memory mapping
+  void  *map;
+  size_t maplength;
+
+  // fallback read buffer (kept between frames)
+  float *buffer;
+  int    buffersize;
+};
+
+WaveData waveDataInit(){
+  WaveData data;
+  data.values = NULL;
+  data.npoints = 0;
+  data.map = NULL;
+  data.maplength = 0;
+  data.buffer = NULL;
+  data.buffersize = 0;
+  return data;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// releases the mapping of the current frame (the fallback buffer is kept for the next frame)
+
+void closeWaveData(WaveData &data){
+  if (data.map != NULL) munmap(data.map,data.maplength);
+  data.map = NULL;
+  data.maplength = 0;
+  data.values = NULL;
+  data.npoints = 0;
+}
+
+void freeWaveData(WaveData &data){
+  closeWaveData(data);
+  if (data.buffer != NULL) free(data.buffer);
+  data.buffer = NULL;
+  data.buffersize = 0;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// checks if file is a shakemovie packet with fortran records
+
+bool isPacketFile(const char *filename){
+  const char *ext = strrchr(filename,'.');
+  if (ext == NULL || strchr(ext,'/') != NULL) return false;
+  return strcmp(ext,".gz") == 0 || strcmp(ext,".d") == 0 || strcmp(ext,".xy") == 0;
+}
+
+// reads fortran records of nfloats values each (gzip compressed or not)
+// strips record markers and appends values to buffer (re-allocated if needed)
+// returns number of records, or -1 on error
+
+int readPacketFile(const char *filename, int nfloats, float* &buffer, int &buffersize){
+
+  gzFile gz = gzopen(filename,"rb");
+  if (gz == NULL) {
+    std::cerr << "Error: Could not open data file " << filename << std::endl;
+    return -1;
+  }
+  gzbuffer(gz,256*1024);
+
+  const int nchunk = 65536;
+  const int recordlength = nfloats+2;
+  const int marker = nfloats*sizeof(float);
+  int *records = (int *)malloc(nchunk*recordlength*sizeof(int));
+  if (records == NULL) {
+    std::cerr << "Error. could not allocate record buffer. Exiting." << std::endl;
+    gzclose(gz);
+    return -1;
+  }
+
+  int nrecords = 0;
+  int ret;
+  while ((ret = gzread(gz,records,nchunk*recordlength*sizeof(int))) > 0) {
+    if (ret % (recordlength*sizeof(int)) != 0) break;
+    int n = ret/(recordlength*sizeof(int));
+
+    // grows value buffer
+    if ((nrecords+n)*nfloats > buffersize) {
+      int size = 2*(nrecords+n)*nfloats;
+      float *newbuffer = (float *)realloc(buffer,size*sizeof(float));
+      if (newbuffer == NULL) {
+        std::cerr << "Error. could not allocate data buffer. Exiting." << std::endl;
+        ret = -1;
+        break;
+      }
+      buffer = newbuffer;
+      buffersize = size;
+    }
+
+    // strips fortran record markers
+    const int *record = records;
+    float *values = buffer + nrecords*nfloats;
+    for (int i=0; i<n; i++, record+=recordlength, values+=nfloats) {
+      if (record[0] != marker || record[nfloats+1] != marker) {
+        std::cerr << "Error. expected fortran record boundary == " << marker << " in " << filename
+                  << ", but got " << record[0] << " / " << record[nfloats+1] << std::endl;
+        free(records);
+        gzclose(gz);
+        return -1;
+      }
+      memcpy(values,record+1,nfloats*sizeof(float));
+    }
+    nrecords += n;
+  }
+
+  if (ret != 0) {
+    int err;
+    std::cerr << "Error. could not read records of " << filename << ": " << gzerror(gz,&err) << std::endl;
+    nrecords = -1;
+  }
+
+  free(records);
+  gzclose(gz);
+  return nrecords;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// reads coordinate points as (lat,lon) pairs, either from a raw float file with npoints pairs or
+// from a bin_movie.xy packet, which also determines npoints
+// returns newly allocated array, or NULL on error
+
+float* readWaveCoords(const char *filename, int &npoints){
+
+  float *coords = NULL;
+
+  if (isPacketFile(filename)) {
+    int size = 0;
+    int n = readPacketFile(filename,2,coords,size);
+    if (n <= 0) {
+      if (coords != NULL) free(coords);
+      if (n == 0) std::cerr << "Error. no coordinate points in " << filename << std::endl;
+      return NULL;
+    }
+    if (n != npoints) std::cerr << "coordinates: " << n << " points in " << filename << std::endl;
+    npoints = n;
+
+    // packets store (lon,lat), raw coordinate files (as written by genDataFromBin) (lat,lon)
+    for (int idx=0; idx<2*n; idx+=2) {
+      float f = coords[idx];
+      coords[idx] = coords[idx+1];
+      coords[idx+1] = f;
+    }
+    return coords;
+  }
+
+  coords = (float *)malloc(npoints*2*sizeof(float));
+  if (coords == NULL) {
+    std::cerr << "Error. could not allocate coords. Exiting." << std::endl;
+    return NULL;
+  }
+
+  FILE *fptr= fopen(filename,"rb");
+  if (fptr==NULL) {
+    std::cerr << "Error: Could not open coords file " << filename << std::endl;
+    free(coords);
+    return NULL;
+  }
+  int ret = fread (coords,sizeof(float),npoints*2,fptr);
+  fclose(fptr);
+  if (ret < npoints*2){
+    std::cerr << "Error. could not read coords data. Exiting." << std::endl;
+    free(coords);
+    return NULL;
+  }
+
+  return coords;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// reads element connectivity as quads of 4 (int) point indices from a raw file, corners following
+// each other around the element face. indices are 0-based; 1-based files (as for AVS/DX) get shifted.
+// returns newly allocated array with 4*nquads indices, or NULL on error
+
+int* readWaveQuads(const char *filename, int npoints, int &nquads){
+
+  nquads = 0;
+
+  FILE *fptr= fopen(filename,"rb");
+  if (fptr==NULL) {
+    std::cerr << "Error: Could not open connectivity file " << filename << std::endl;
+    return NULL;
+  }
+  fseek(fptr,0,SEEK_END);
+  long size = ftell(fptr);
+  fseek(fptr,0,SEEK_SET);
+
+  if (size <= 0 || size % (4*sizeof(int)) != 0) {
+    std::cerr << "Error. connectivity file " << filename << " has no (int) quads. Exiting." << std::endl;
+    fclose(fptr);
+    return NULL;
+  }
+  int n = (int)(size / (4*sizeof(int)));
+
+  int *quads = (int *)malloc(sizeof(int)*4*n);
+  if (quads == NULL) {
+    std::cerr << "Error. could not allocate quads. Exiting." << std::endl;
+    fclose(fptr);
+    return NULL;
+  }
+  int ret = fread(quads,sizeof(int),4*n,fptr);
+  fclose(fptr);
+  if (ret < 4*n){
+    std::cerr << "Error. could not read connectivity data. Exiting." << std::endl;
+    free(quads);
+    return NULL;
+  }
+
+  int minidx = quads[0];
+  int maxidx = quads[0];
+  for (int k=1; k<4*n; k++) {
+    if (quads[k] < minidx) minidx = quads[k];
+    if (quads[k] > maxidx) maxidx = quads[k];
+  }
+  if (minidx >= 1 && maxidx == npoints) {
+    for (int k=0; k<4*n; k++) quads[k]--;
+    minidx--;
+    maxidx--;
+  }
+  if (minidx < 0 || maxidx >= npoints) {
+    std::cerr << "Error. connectivity indices " << minidx << " .. " << maxidx << " out of range for "
+              << npoints << " points. Exiting." << std::endl;
+    free(quads);
+    return NULL;
+  }
+
+  nquads = n;
+  return quads;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// opens frame file and provides its npoints values in data.values
+// returns true on success
+
+bool openWaveData(const char *filename, int npoints, WaveData &data){
+
+  closeWaveData(data);
+
+  // shakemovie packet
+  if (isPacketFile(filename)) {
+    int n = readPacketFile(filename,1,data.buffer,data.buffersize);
+    if (n < 0) return false;
+    if (n != npoints) {
+      std::cerr << "Error. expected " << npoints << " points in " << filename << ", got " << n << ". Exiting." << std::endl;
+      return false;
+    }
+    data.values = data.buffer;
+    data.npoints = npoints;
+    return true;
+  }
+
+  int fd = open(filename,O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Could not open data file " << filename << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd,&st) != 0 || (size_t)st.st_size < (size_t)npoints*sizeof(float)) {
+    std::cerr << "Error. could not read amplitude values of " << filename << ". Exiting." << std::endl;
+    close(fd);
+    return false;
+  }
+
+  // maps whole file
+  size_t length = (size_t)npoints*sizeof(float);
+  void *map = mmap(NULL,length,PROT_READ,MAP_PRIVATE|MAP_POPULATE,fd,0);
+  if (map != MAP_FAILED) {
+    madvise(map,length,MADV_SEQUENTIAL);
+    close(fd);
+    data.map = map;
+    data.maplength = length;
+    data.values = (const float*) map;
+    data.npoints = npoints;
+    return true;
+  }
+
+  // fall back to a single read of the whole frame
+  if (data.buffersize < npoints) {
+    if (data.buffer != NULL) free(data.buffer);
+    data.buffer = (float *)malloc(length);
+    if (data.buffer == NULL) {
+      std::cerr << "Error. could not allocate data buffer. Exiting." << std::endl;
+      data.buffersize = 0;
+      close(fd);
+      return false;
+    }
+    data.buffersize = npoints;
+  }
+
+  FILE *fptr = fdopen(fd,"rb");
+  if (fptr == NULL) {
+    std::cerr << "Error: Could not open data file " << filename << std::endl;
+    close(fd);
+    return false;
+  }
+  size_t ret = fread(data.buffer,sizeof(float),npoints,fptr);
+  fclose(fptr);
+  if (ret < (size_t)npoints) {
+    std::cerr << "Error. could not read amplitude values of " << filename << ". Exiting." << std::endl;
+    return false;
+  }
+
+  data.values = data.buffer;
+  data.npoints = npoints;
+  return true;
+}
+
+/* -----------------------------------------------------------------------------------------------
+
+wavefield container
+
+ a container file (written by genDataFromBin -o) holds coordinates and all frames. it gets mapped
+ once, and each frame is then a pointer into the mapping.
+
+----------------------------------------------------------------------------------------------- */
+
+struct WaveContainer {
+  void  *map;
+  size_t maplength;
+  const WaveContainerHeader *header;
+  const WaveContainerFrame  *table;
+};
+
+WaveContainer waveContainerInit(){
+  WaveContainer container;
+  container.map = NULL;
+  container.maplength = 0;
+  container.header = NULL;
+  container.table = NULL;
+  return container;
+}
+
+void closeWaveContainer(WaveContainer &container){
+  if (container.map != NULL) munmap(container.map,container.maplength);
+  container = waveContainerInit();
+}
+
+// maps container file and checks its header and frame table
+// returns true on success
+
+bool openWaveContainer(const char *filename, WaveContainer &container){
+
+  closeWaveContainer(container);
+
+  int fd = open(filename,O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Could not open data container " << filename << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd,&st) != 0 || (size_t)st.st_size < sizeof(WaveContainerHeader)) {
+    std::cerr << "Error. invalid data container " << filename << std::endl;
+    close(fd);
+    return false;
+  }
+
+  size_t length = st.st_size;
+  void *map = mmap(NULL,length,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    std::cerr << "Error. could not map data container " << filename << std::endl;
+    return false;
+  }
+
+  container.map = map;
+  container.maplength = length;
+  container.header = (const WaveContainerHeader *) map;
+
+  const WaveContainerHeader *header = container.header;
+  if (memcmp(header->magic,WAVE_CONTAINER_MAGIC,8) != 0 || header->version != WAVE_CONTAINER_VERSION) {
+    std::cerr << "Error. " << filename << " is not a data container (version " << WAVE_CONTAINER_VERSION << ")" << std::endl;
+    closeWaveContainer(container);
+    return false;
+  }
+  if (waveContainerFrameSize(header->encoding,header->npts) < 0) {
+    std::cerr << "Error. unknown frame encoding " << header->encoding << " in data container " << filename << std::endl;
+    closeWaveContainer(container);
+    return false;
+  }
+  if (header->npts <= 0 || header->nframes < 0
+      || header->coords_offset < 0 || header->table_offset < 0
+      || header->data_offset < 0 || header->data_offset > (int64_t)length
+      || header->coords_offset + (int64_t)header->npts*2*(int64_t)sizeof(float) > (int64_t)length
+      || header->table_offset + (int64_t)header->nframes*(int64_t)sizeof(WaveContainerFrame) > (int64_t)length) {
+    std::cerr << "Error. truncated data container " << filename << std::endl;
+    closeWaveContainer(container);
+    return false;
+  }
+
+  // frames lie in data section and hold all points
+  int64_t framesize = waveContainerFrameSize(header->encoding,header->npts);
+  container.table = (const WaveContainerFrame *)((const char *)map + header->table_offset);
+  for (int k=0; k<header->nframes; k++) {
+    if (container.table[k].offset < header->data_offset
+        || container.table[k].offset % sizeof(float) != 0
+        || container.table[k].size != framesize
+        || container.table[k].offset + container.table[k].size > (int64_t)length) {
+      std::cerr << "Error. truncated data container " << filename << ", frame " << k << std::endl;
+      closeWaveContainer(container);
+      return false;
+    }
+  }
+
+  std::cerr << "data container: " << filename << std::endl;
+  std::cerr << "  points: " << header->npts << "  frames: " << header->nframes
+            << "  interval: " << header->interval << "  start: " << header->start
+            << "  encoding: " << waveEncodingName(header->encoding) << std::endl;
+  return true;
+}
+
+// copy of container coordinates, as (lat,lon) pairs like the raw coordinate files
+
+float* readWaveContainerCoords(const WaveContainer &container, int &npoints){
+  npoints = container.header->npts;
+  float *coords = (float *)malloc(npoints*2*sizeof(float));
+  if (coords == NULL) {
+    std::cerr << "Error. could not allocate coords. Exiting." << std::endl;
+    return NULL;
+  }
+  memcpy(coords,(const char *)container.map + container.header->coords_offset,npoints*2*sizeof(float));
+  return coords;
+}
+
+// provides values of container frame k in data.values
+
+bool openWaveContainerFrame(const WaveContainer &container, int k, int npoints, WaveData &data){
+
+  closeWaveData(data);
+
+  if (k < 0 || k >= container.header->nframes) {
+    std::cerr << "Error. frame " << k << " not in data container (0 - " << container.header->nframes-1 << ")" << std::endl;
+    return false;
+  }
+  if (npoints != container.header->npts) {
+    std::cerr << "Error. expected " << npoints << " points in data container, got " << container.header->npts << std::endl;
+    return false;
+  }
+
+  const unsigned char *payload = (const unsigned char *)container.map + container.table[k].offset;
+  int encoding = container.header->encoding;
+
+  if (encoding == WAVE_ENCODING_FLOAT32) {
+    // raw values, used in place
+    data.values = (const float *) payload;
+    data.npoints = npoints;
+    return true;
+  }
+
+  // quantized values
+  if (data.buffersize < npoints) {
+    if (data.buffer != NULL) free(data.buffer);
+    data.buffer = (float *)malloc(npoints*sizeof(float));
+    if (data.buffer == NULL) {
+      std::cerr << "Error. could not allocate data buffer. Exiting." << std::endl;
+      data.buffersize = 0;
+      return false;
+    }
+    data.buffersize = npoints;
+  }
+  waveDecodeFrame(encoding,payload,npoints,data.buffer);
+
+  data.values = data.buffer;
+  data.npoints = npoints;
+  return true;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+// min/max statistics of frame values
+//
+// uses 8 independent lanes so the compiler can keep the loop in vector registers
+
+void waveDataMinMax(const float *values, int n, float &minv, float &maxv){
+  if (n <= 0) {
+    minv = maxv = 0.0f;
+    return;
+  }
+
+  const int NLANES = 8;
+  float lanemin[NLANES];
+  float lanemax[NLANES];
+  for (int k=0; k<NLANES; k++) lanemin[k] = lanemax[k] = values[0];
+
+  int nblock = n - n%NLANES;
+  for (int i=0; i<nblock; i+=NLANES) {
+    for (int k=0; k<NLANES; k++) {
+      float f = values[i+k];
+      lanemin[k] = f < lanemin[k] ? f : lanemin[k];
+      lanemax[k] = f > lanemax[k] ? f : lanemax[k];
+    }
+  }
+  for (int i=nblock; i<n; i++) {
+    float f = values[i];
+    lanemin[0] = f < lanemin[0] ? f : lanemin[0];
+    lanemax[0] = f > lanemax[0] ? f : lanemax[0];
+  }
+
+  minv = lanemin[0];
+  maxv = lanemax[0];
+  for (int k=1; k<NLANES; k++) {
+    if (lanemin[k] < minv) minv = lanemin[k];
+    if (lanemax[k] > maxv) maxv = lanemax[k];
+  }
+}
+
+#endif  // WAVEDATA_H
@@ -0,0 +1,177 @@
+/*-----------------------------------------------------------------------
+  shakeMovie
+
+  originally written by Santiago v Lombeyda, Caltech, 11/2006
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+-----------------------------------------------------------------------*/
+
+// wavePrefetch.h
+#ifndef WAVEPREFETCH_H
+#define WAVEPREFETCH_H
+
+#include <thread>
+
+/* -----------------------------------------------------------------------------------------------
+
+wavefield prefetch
+
+ reads and splats the next frame on a separate thread into its own wave map, while the current
+ frame gets rendered. the renderer takes the prefetched wave map by swapping buffer pointers with
+ it, so that its old buffers receive the frame after. splatting only reads the splat context
+ (see SplatContext), the frame data buffer and the value bounds belong to the prefetch.
+
+----------------------------------------------------------------------------------------------- */
+
+class WavePrefetch {
+public:
+  WavePrefetch();
+  ~WavePrefetch();
+
+  bool init(const SplatContext &splatter);
+  void start(int nframe, const unsigned short* wavesd, bool verbose=false);
+  bool take(int nframe, float* &waves, short* &wavesc, unsigned char* &wavest, float &minval, float &maxval,
+            SplatTiming *timing=NULL);
+  void release();
+
+private:
+  const SplatContext *splatter;
+  std::thread worker;
+
+  // prefetched frame (and whether it was read successfully)
+  int  nframe;
+  bool pending;
+  bool ok;
+
+  // wave map, value bounds and frame data buffer of prefetched frame
+  float *waves;
+  short *wavesc;
+  unsigned char *wavest;
+  float minval;
+  float maxval;
+  WaveData wavedata;
+  SplatTiming splattiming;
+
+  void wait();
+
+  // not copyable (owns its buffers and thread)
+  WavePrefetch(const WavePrefetch&);
+  WavePrefetch& operator=(const WavePrefetch&);
+};
+
+WavePrefetch::WavePrefetch() {
+  splatter = NULL;
+  nframe = 0;
+  pending = false;
+  ok = false;
+  waves = NULL;
+  wavesc = NULL;
+  wavest = NULL;
+  minval = 0.0f;
+  maxval = 0.0f;
+  wavedata = waveDataInit();
+}
+
+WavePrefetch::~WavePrefetch() {
+  release();
+}
+
+// allocates wave map of the splatter's dimensions
+
+bool WavePrefetch::init(const SplatContext &splat) {
+  TRACE("wavePrefetch: init")
+
+  release();
+  splatter = &splat;
+
+  waves  = (float *)malloc(splatter->wavesOnMapSize*sizeof(float));
+  wavesc = (short *)malloc(splatter->wavesOnMapSize*sizeof(short));
+  wavest = (unsigned char *)malloc(splatter->ntilesx*splatter->ntilesy*sizeof(unsigned char));
+  if (waves == NULL || wavesc == NULL || wavest == NULL) {
+    std::cerr << "Error. could not allocate prefetch wavefield. Exiting." << std::endl;
+    release();
+    return false;
+  }
+  memset(wavest,1,splatter->ntilesx*splatter->ntilesy*sizeof(unsigned char));
+  return true;
+}
+
+// starts reading and splatting frame nframe
+
+void WavePrefetch::start(int frame, const unsigned short* wavesd, bool verbose) {
+  TRACE("wavePrefetch: start")
+
+  if (splatter == NULL) return;
+  wait();
+
+  nframe = frame;
+  pending = true;
+  ok = false;
+  splattiming = SplatTiming();
+
+  // OpenMP thread count of the caller (a new thread starts with the default count,
+  // workers of the frame farm splat with a single thread)
+#if defined(_OPENMP)
+  int nthreads = omp_get_max_threads();
+#else
+  int nthreads = 1;
+#endif
+  worker = std::thread([this,wavesd,verbose,nthreads]() {
+#if defined(_OPENMP)
+    omp_set_num_threads(nthreads);
+#endif
+    ok = splatter->readAndSplatWaves(nframe,waves,wavesc,wavest,wavesd,wavedata,minval,maxval,verbose,&splattiming);
+  });
+}
+
+void WavePrefetch::wait() {
+  if (worker.joinable()) worker.join();
+}
+
+// takes prefetched frame nframe: swaps the wave map with the given one
+// returns false if frame nframe has not been prefetched
+
+bool WavePrefetch::take(int frame, float* &wv, short* &wvc, unsigned char* &wvt, float &vmin, float &vmax,
+                        SplatTiming *timing) {
+  TRACE("wavePrefetch: take")
+
+  wait();
+  if (! pending || nframe != frame || ! ok) {
+    pending = false;
+    return false;
+  }
+  pending = false;
+
+  std::swap(waves,wv);
+  std::swap(wavesc,wvc);
+  std::swap(wavest,wvt);
+  vmin = minval;
+  vmax = maxval;
+  if (timing != NULL) *timing = splattiming;
+  return true;
+}
+
+void WavePrefetch::release() {
+  wait();
+  pending = false;
+
+  if (waves != NULL) free(waves);
+  if (wavesc != NULL) free(wavesc);
+  if (wavest != NULL) free(wavest);
+  waves = NULL;
+  wavesc = NULL;
+  wavest = NULL;
+
+  freeWaveData(wavedata);
+  splatter = NULL;
+}
+
+#endif  // WAVEPREFETCH_H
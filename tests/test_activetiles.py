@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# regression test: skipping inactive wave map tiles (default) must not change the rendered images
+#
+# renders a wavefield which is zero for longitudes > 0 with and without -noactivetiles, and
+# compares the images byte by byte. the grid points get sparse towards the poles, which leaves gaps
+# in the polar rows of the wave map that get flood filled along the whole row.
+#
+# usage (from the root directory, after make):
+#   ./tests/test_activetiles.py [path/to/renderOnSphere]
+#
+import array
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+renderer = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "bin/renderOnSphere")
+
+# views (and splat options) to compare
+views = [
+    ["-latitude", "89", "-longitude", "30"],
+    ["-latitude", "80", "-longitude", "60", "-splatpasses", "3", "-linefill"],
+    ["-latitude", "-85", "-longitude", "-20", "-splatkernel", "5"],
+    ["-latitude", "10", "-longitude", "-60"],
+]
+nframes = 2
+
+
+def write_data(dir):
+    # grid points (lat,lon) every degree, fewer towards the poles (as for a mesh of the globe)
+    coords = array.array('f')
+    for i in range(180):
+        lat = -89.5 + i
+        nlon = max(4, int(360*math.cos(math.radians(lat))))
+        for j in range(nlon):
+            coords.append(lat)
+            coords.append(-180.0 + (j + 0.5)*360.0/nlon)
+    with open(os.path.join(dir, "xy"), "wb") as f:
+        coords.tofile(f)
+    npoints = len(coords) // 2
+
+    # frames: zero for longitudes > 0
+    for n in range(nframes):
+        values = array.array('f', [0.0]) * npoints
+        for k in range(npoints):
+            lon = coords[2*k+1]
+            if lon <= 0.0:
+                values[k] = 1.e-3 * (0.5 + 0.5*math.cos(math.radians(4.0*lon + 30.0*n)))
+        with open(os.path.join(dir, "%06d.v" % n), "wb") as f:
+            values.tofile(f)
+
+    # globe map: TGA, 1024 x 512, gray checker board
+    w, h = 1024, 512
+    header = bytes([0, 0, 2] + [0]*9 + [w % 256, w // 256, h % 256, h // 256, 24, 0])
+    row0 = bytes((96 if (i // 32) % 2 else 160) for i in range(w) for c in range(3))
+    row1 = bytes((160 if (i // 32) % 2 else 96) for i in range(w) for c in range(3))
+    with open(os.path.join(dir, "map.tga"), "wb") as f:
+        f.write(header)
+        for j in range(h):
+            f.write(row0 if (j // 32) % 2 else row1)
+
+    return npoints
+
+
+def render(dir, outdir, options):
+    os.mkdir(outdir)
+    args = [renderer,
+            "-size", "400", "300", "-radius", "150",
+            "-map", os.path.join(dir, "map.tga"), "-texturetomapfactor", "1",
+            "-coordsfile", os.path.join(dir, "xy"), "-ncoords", str(npoints),
+            "-datafiletemplate", os.path.join(dir, "%06d.v"),
+            "-firstframe", "0", "-lastframe", str(nframes-1), "-framestep", "1",
+            "-ppm", "-nocities"] + options
+    with open(os.path.join(outdir, "log.txt"), "w") as log:
+        ret = subprocess.call(args, cwd=outdir, stdout=log, stderr=subprocess.STDOUT)
+    if ret != 0:
+        print("Error. renderOnSphere failed, see %s" % os.path.join(outdir, "log.txt"))
+        sys.exit(1)
+    return sorted(f for f in os.listdir(outdir) if f.endswith(".ppm"))
+
+
+dir = tempfile.mkdtemp(prefix="test_activetiles.")
+npoints = write_data(dir)
+
+failed = 0
+for n, options in enumerate(views):
+    tiles = os.path.join(dir, "view%d" % n)
+    notiles = os.path.join(dir, "view%d.noactivetiles" % n)
+    images = render(dir, tiles, options)
+    render(dir, notiles, options + ["-noactivetiles"])
+
+    differ = []
+    for image in images:
+        with open(os.path.join(tiles, image), "rb") as f1, open(os.path.join(notiles, image), "rb") as f2:
+            if f1.read() != f2.read():
+                differ.append(image)
+
+    print("%-60s %s" % (" ".join(options), "ok" if not differ else "FAILED: " + " ".join(differ)))
+    if differ or not images:
+        failed += 1
+
+if failed:
+    print("%d of %d views differ with -noactivetiles, output kept in %s" % (failed, len(views), dir))
+    sys.exit(1)
+
+shutil.rmtree(dir)
+print("all views identical with -noactivetiles")